@@ -1,33 +1,123 @@
 #include <stdio.h>
 #include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
 #include <zephyr/drivers/i2c.h>
 
-static const struct device *const i2c_dev = DEVICE_DT_GET(DT_ALIAS(my_i2cbus));
+#include "i2c_probe.h"
 
-int main(void){
-    int ret;
-    uint8_t dummy = 0x00;
+#define MAX_FOUND 32                // Per bus
+
+struct scan_bus {
+    const struct device *dev;
+    const char *label;              // Devicetree node label, used in the overlay
+};
+
+// Every bus below that is enabled in the devicetree gets scanned
+#define SCAN_BUS(label)                                                     \
+    COND_CODE_1(DT_NODE_HAS_STATUS(DT_NODELABEL(label), okay),              \
+                ({ DEVICE_DT_GET(DT_NODELABEL(label)), #label },), ())
+
+static const struct scan_bus buses[] = {
+    SCAN_BUS(i2c0)
+    SCAN_BUS(i2c1)
+    SCAN_BUS(i2c2)
+    SCAN_BUS(i2c3)
+};
+
+struct found {
+    uint16_t addr;
+    uint16_t raw;
+    const struct i2c_fingerprint *fp;
+};
+
+static struct found found[MAX_FOUND];
+
+// Probe the whole address range back to back, no delay between addresses
+static int scan(const struct device *dev, uint32_t *us)
+{
+    uint32_t start = k_cycle_get_32();
+    int n = 0;
+
+    for (uint16_t addr = I2C_PROBE_FIRST; addr <= I2C_PROBE_LAST; addr++) {
+        if (i2c_probe(dev, addr) && n < MAX_FOUND) {
+            found[n++].addr = addr;
+        }
+    }
+
+    *us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return n;
+}
+
+static void print_node(const struct found *f)
+{
+    const struct i2c_fingerprint *fp = f->fp;
 
-    if(!device_is_ready(i2c_dev)){
-        printk("Device %s is not ready.\n", i2c_dev->name);
-        return 0;
+    if (fp == NULL) {
+        printk("\t/* Unknown device at 0x%02x */\n", f->addr);
+        return;
     }
+
+    if (fp->compatible == NULL) {
+        printk("\t/* %s at 0x%02x: %s */\n", fp->name, f->addr,
+               fp->note ? fp->note : "no Zephyr driver");
+        return;
+    }
+
+    if (fp->note != NULL) {
+        printk("\t/* %s */\n", fp->note);
+    }
+    printk("\t%s_%02x: %s@%x {\n", fp->name, f->addr, fp->name, f->addr);
+    printk("\t\tcompatible = \"%s\";\n", fp->compatible);
+    printk("\t\treg = <0x%02x>;\n", f->addr);
+    printk("\t\tstatus = \"okay\";\n");
+    printk("\t};\n");
+}
+
+int main(void){
+    int total = 0;
+
     printk("I2C scanner started\n");
-    printk("Scanning addresses 0x03 to 0x77\n");
+    printk("Scanning addresses 0x%02X to 0x%02X on %u bus(es)\n",
+           I2C_PROBE_FIRST, I2C_PROBE_LAST, (unsigned int)ARRAY_SIZE(buses));
+
+    for (size_t b = 0; b < ARRAY_SIZE(buses); b++) {
+        const struct scan_bus *bus = &buses[b];
+        uint32_t us;
+        int n;
+
+        if (!device_is_ready(bus->dev)) {
+            printk("Device %s is not ready.\n", bus->dev->name);
+            continue;
+        }
 
-    for(uint8_t addr = 0x03; addr <= 0x77; addr++){
+        n = scan(bus->dev, &us);
+        printk("%s: %d device(s) in %u us\n", bus->label, n, us);
 
-        /* Zero-length write is enough to test ACK */
-        ret = i2c_write(i2c_dev, &dummy, 0, addr);
+        // Identify after the scan so the timing above is the probe alone
+        for (int i = 0; i < n; i++) {
+            found[i].fp = i2c_fingerprint(bus->dev, found[i].addr, &found[i].raw);
+            printk("✔ Device found at 0x%02X: %s", found[i].addr,
+                   found[i].fp ? found[i].fp->name : "unknown");
+            if (found[i].fp && found[i].fp->reg >= 0) {
+                printk(" (reg 0x%02X = 0x%02X)", found[i].fp->reg, found[i].raw);
+            }
+            printk("\n");
+        }
 
-        if (ret == 0) {
-            printk("✔ Device found at 0x%02X\n", addr);
+        if (n == 0) {
+            continue;
         }
 
-        k_msleep(5);  // small delay to be polite on the bus
+        printk("\n/* Overlay for %s */\n", bus->label);
+        printk("&%s {\n", bus->label);
+        for (int i = 0; i < n; i++) {
+            print_node(&found[i]);
+        }
+        printk("};\n\n");
+        total += n;
     }
 
-    printk("I2C scan complete\n");
+    printk("I2C scan complete, %d device(s)\n", total);
 
     return 0;
-}
\ No newline at end of file
+}
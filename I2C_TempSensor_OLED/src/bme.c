@@ -0,0 +1,294 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "bme.h"
+#include "i2c_sched.h"
+
+// Registers
+#define BME_REG_CALIB_TP 0x88       // dig_T1 .. dig_P9, then dig_H1 at 0xA1
+#define BME_REG_CHIP_ID 0xD0
+#define BME_REG_RESET 0xE0
+#define BME_REG_CALIB_H 0xE1        // dig_H2 .. dig_H6
+#define BME_REG_CTRL_HUM 0xF2
+#define BME_REG_STATUS 0xF3         // Status, ctrl_meas, config, then the data
+#define BME_REG_CTRL_MEAS 0xF4
+#define BME_REG_CONFIG 0xF5
+
+#define BME_CHIP_ID 0x60
+#define BME_RESET_CMD 0xB6
+#define BME_STATUS_MEASURING BIT(3)
+#define BME_STATUS_IM_UPDATE BIT(0)
+#define BME_MODE_FORCED 0x01
+
+// Skipped channels read back as this
+#define BME_ADC_SKIPPED_20 0x80000
+#define BME_ADC_SKIPPED_16 0x8000
+
+// Status at 0xF3 up to the last humidity byte at 0xFE
+#define BME_BURST_LEN 12
+#define BME_BURST_DATA 4            // Offset of press_msb (0xF7)
+
+#define BME_START_UP_MS 2
+#define BME_POLL_US 500
+
+const struct bme_profile bme_profile_low_noise = {
+    "low noise", BME_OS_2X, BME_OS_16X, BME_OS_1X, BME_FILTER_4, 1000,
+};
+
+const struct bme_profile bme_profile_fast = {
+    "fast", BME_OS_1X, BME_OS_1X, BME_OS_1X, BME_FILTER_OFF, 250,
+};
+
+const struct bme_profile bme_profile_weather = {
+    "weather", BME_OS_1X, BME_OS_1X, BME_OS_1X, BME_FILTER_OFF, 60000,
+};
+
+static const struct bme_profile *profile;
+static uint8_t ctrl_meas;
+
+// Only the sensor thread talks to the sensor, one job is enough
+static struct i2c_job job;
+
+// Factory calibration
+static struct {
+    uint16_t t1;
+    int16_t t2, t3;
+    uint16_t p1;
+    int16_t p2, p3, p4, p5, p6, p7, p8, p9;
+    uint8_t h1, h3;
+    int16_t h2, h4, h5;
+    int8_t h6;
+} cal;
+
+// Register access through the bus scheduler, ahead of any display traffic
+static int bme_read(uint8_t reg, uint8_t *buf, uint8_t len)
+{
+    job.msgs[0] = (struct i2c_msg){ .buf = &reg, .len = 1, .flags = I2C_MSG_WRITE };
+    job.msgs[1] = (struct i2c_msg){
+        .buf = buf, .len = len,
+        .flags = I2C_MSG_READ | I2C_MSG_RESTART | I2C_MSG_STOP,
+    };
+    job.num_msgs = 2;
+    return i2c_sched_run(&job);
+}
+
+static int bme_write(uint8_t reg, uint8_t val)
+{
+    uint8_t tx[2] = { reg, val };
+
+    job.msgs[0] = (struct i2c_msg){
+        .buf = tx, .len = sizeof(tx), .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+    job.num_msgs = 1;
+    return i2c_sched_run(&job);
+}
+
+static int bme_read_calibration(void)
+{
+    uint8_t tp[26];
+    uint8_t h[7];
+    int ret;
+
+    ret = bme_read(BME_REG_CALIB_TP, tp, sizeof(tp));
+    if (ret == 0) {
+        ret = bme_read(BME_REG_CALIB_H, h, sizeof(h));
+    }
+    if (ret) {
+        return ret;
+    }
+
+    cal.t1 = sys_get_le16(&tp[0]);
+    cal.t2 = sys_get_le16(&tp[2]);
+    cal.t3 = sys_get_le16(&tp[4]);
+    cal.p1 = sys_get_le16(&tp[6]);
+    cal.p2 = sys_get_le16(&tp[8]);
+    cal.p3 = sys_get_le16(&tp[10]);
+    cal.p4 = sys_get_le16(&tp[12]);
+    cal.p5 = sys_get_le16(&tp[14]);
+    cal.p6 = sys_get_le16(&tp[16]);
+    cal.p7 = sys_get_le16(&tp[18]);
+    cal.p8 = sys_get_le16(&tp[20]);
+    cal.p9 = sys_get_le16(&tp[22]);
+    cal.h1 = tp[25];
+    cal.h2 = sys_get_le16(&h[0]);
+    cal.h3 = h[2];
+    cal.h4 = (int16_t)((int8_t)h[3] * 16 | (h[4] & 0x0f));
+    cal.h5 = (int16_t)((int8_t)h[5] * 16 | (h[4] >> 4));
+    cal.h6 = (int8_t)h[6];
+    return 0;
+}
+
+int bme_init(struct rtio_iodev *iodev)
+{
+    uint8_t id, status;
+    int ret;
+
+    if (!i2c_is_ready_dt((const struct i2c_dt_spec *)iodev->data)) {
+        return -ENODEV;
+    }
+    job.iodev = iodev;
+    job.prio = I2C_PRIO_HIGH;
+
+    ret = bme_read(BME_REG_CHIP_ID, &id, 1);
+    if (ret) {
+        return ret;
+    }
+    if (id != BME_CHIP_ID) {
+        return -ENOTSUP;
+    }
+
+    // Soft reset, then wait for the calibration data to be copied to the
+    // registers
+    ret = bme_write(BME_REG_RESET, BME_RESET_CMD);
+    if (ret) {
+        return ret;
+    }
+    do {
+        k_msleep(BME_START_UP_MS);
+        ret = bme_read(BME_REG_STATUS, &status, 1);
+    } while (ret == 0 && (status & BME_STATUS_IM_UPDATE));
+    if (ret) {
+        return ret;
+    }
+
+    ret = bme_read_calibration();
+    if (ret) {
+        return ret;
+    }
+    // A re-init after the sensor was replugged keeps the profile in use
+    return bme_set_profile(profile != NULL ? profile : &bme_profile_low_noise);
+}
+
+int bme_set_profile(const struct bme_profile *p)
+{
+    int ret;
+
+    // The sensor is asleep between forced conversions, the only state in
+    // which the config register may be written. ctrl_hum is latched by the
+    // next ctrl_meas write, which is the trigger of the next sample.
+    ret = bme_write(BME_REG_CTRL_HUM, p->osrs_h);
+    if (ret == 0) {
+        ret = bme_write(BME_REG_CONFIG, p->filter << 2);
+    }
+    if (ret) {
+        return ret;
+    }
+
+    ctrl_meas = (p->osrs_t << 5) | (p->osrs_p << 2) | BME_MODE_FORCED;
+    profile = p;
+    return 0;
+}
+
+const struct bme_profile *bme_get_profile(void)
+{
+    return profile;
+}
+
+uint32_t bme_measure_time_us(const struct bme_profile *p)
+{
+    // Datasheet 9.1, maximum: 1.25 ms + 2.3 ms per temperature oversample
+    // + 2.3 ms per pressure and humidity oversample plus 0.575 ms each
+    uint32_t us = 1250 + 2300 * (p->osrs_t ? BIT(p->osrs_t - 1) : 0);
+
+    if (p->osrs_p) {
+        us += 2300 * BIT(p->osrs_p - 1) + 575;
+    }
+    if (p->osrs_h) {
+        us += 2300 * BIT(p->osrs_h - 1) + 575;
+    }
+    return us;
+}
+
+// Datasheet 4.2.3 integer compensation. Temperature in 0.01 C.
+static int32_t compensate_t(int32_t adc, int32_t *t_fine)
+{
+    int32_t var1 = (((adc >> 3) - ((int32_t)cal.t1 * 2)) * cal.t2) >> 11;
+    int32_t var2 = (((((adc >> 4) - cal.t1) * ((adc >> 4) - cal.t1)) >> 12) *
+                    cal.t3) >> 14;
+
+    *t_fine = var1 + var2;
+    return (*t_fine * 5 + 128) >> 8;
+}
+
+// Pressure in Pa, Q24.8
+static uint32_t compensate_p(int32_t adc, int32_t t_fine)
+{
+    int64_t var1 = (int64_t)t_fine - 128000;
+    int64_t var2 = var1 * var1 * cal.p6;
+    int64_t p;
+
+    var2 += (var1 * cal.p5) * (1LL << 17);
+    var2 += (int64_t)cal.p4 * (1LL << 35);
+    var1 = ((var1 * var1 * cal.p3) >> 8) + ((var1 * cal.p2) * (1LL << 12));
+    var1 = (((1LL << 47) + var1) * cal.p1) >> 33;
+    if (var1 == 0) {
+        return 0;
+    }
+
+    p = 1048576 - adc;
+    p = ((p * (1LL << 31)) - var2) * 3125 / var1;
+    var1 = ((int64_t)cal.p9 * (p >> 13) * (p >> 13)) >> 25;
+    var2 = ((int64_t)cal.p8 * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + ((int64_t)cal.p7 * 16);
+    return (uint32_t)p;
+}
+
+// Humidity in %RH, Q22.10
+static uint32_t compensate_h(int32_t adc, int32_t t_fine)
+{
+    int32_t v = t_fine - 76800;
+
+    v = (((adc << 14) - (cal.h4 * (1 << 20)) - (cal.h5 * v) + 16384) >> 15) *
+        (((((((v * cal.h6) >> 10) * (((v * cal.h3) >> 11) + 32768)) >> 10) +
+           2097152) * cal.h2 + 8192) >> 14);
+    v -= ((((v >> 15) * (v >> 15)) >> 7) * cal.h1) >> 4;
+    v = CLAMP(v, 0, 419430400);
+    return (uint32_t)v >> 12;
+}
+
+int bme_sample(struct bme280_sample *out)
+{
+    uint8_t buf[BME_BURST_LEN];
+    int ret;
+
+    // Trigger: the sensor converts once and goes back to sleep
+    ret = bme_write(BME_REG_CTRL_MEAS, ctrl_meas);
+    if (ret) {
+        return ret;
+    }
+
+    // Sleep through the conversion instead of polling the bus
+    k_usleep(bme_measure_time_us(profile));
+
+    // Status and all three channels in one transaction, only read again if
+    // the conversion is unexpectedly still running
+    while (1) {
+        ret = bme_read(BME_REG_STATUS, buf, sizeof(buf));
+        if (ret) {
+            return ret;
+        }
+        if (!(buf[0] & BME_STATUS_MEASURING)) {
+            break;
+        }
+        k_usleep(BME_POLL_US);
+    }
+
+    const uint8_t *d = &buf[BME_BURST_DATA];
+    int32_t adc_p = (sys_get_be24(&d[0])) >> 4;
+    int32_t adc_t = (sys_get_be24(&d[3])) >> 4;
+    int32_t adc_h = sys_get_be16(&d[6]);
+    int32_t t_fine;
+
+    if (adc_t == BME_ADC_SKIPPED_20) {
+        return -ENODATA;        // Pressure and humidity need the temperature
+    }
+
+    out->temp_mc = compensate_t(adc_t, &t_fine) * 10;
+    out->press_pa = adc_p == BME_ADC_SKIPPED_20 ? 0 :
+                    compensate_p(adc_p, t_fine) >> 8;
+    out->hum_mrh = adc_h == BME_ADC_SKIPPED_16 ? 0 :
+                   (uint32_t)(((uint64_t)compensate_h(adc_h, t_fine) * 1000) >> 10);
+    return 0;
+}
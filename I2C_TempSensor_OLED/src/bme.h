@@ -0,0 +1,63 @@
+#ifndef BME_H
+#define BME_H
+
+#include <stdint.h>
+#include <zephyr/rtio/rtio.h>
+
+#include "sensor_bus.h"
+
+/* BME280 in forced mode: every sample is one triggered conversion, after
+ which the sensor goes back to sleep on its own. A sample costs two bus
+ transactions, the trigger write and one burst read of status and all
+ three channels. Both go through i2c_sched.c at high priority.*/
+
+// Oversampling register values, BME_OS_SKIP turns the channel off
+enum bme_os {
+    BME_OS_SKIP = 0,
+    BME_OS_1X,
+    BME_OS_2X,
+    BME_OS_4X,
+    BME_OS_8X,
+    BME_OS_16X,
+};
+
+// IIR filter coefficient register values (temperature and pressure only)
+enum bme_filter {
+    BME_FILTER_OFF = 0,
+    BME_FILTER_2,
+    BME_FILTER_4,
+    BME_FILTER_8,
+    BME_FILTER_16,
+};
+
+struct bme_profile {
+    const char *name;
+    uint8_t osrs_t;             // enum bme_os
+    uint8_t osrs_p;
+    uint8_t osrs_h;
+    uint8_t filter;             // enum bme_filter
+    uint32_t period_ms;         // Time between samples
+};
+
+// Presets after the datasheet's recommended modes of operation
+extern const struct bme_profile bme_profile_low_noise;     // Indoor, steady readings
+extern const struct bme_profile bme_profile_fast;          // Quick response to changes
+extern const struct bme_profile bme_profile_weather;       // One sample a minute, lowest power
+
+// Check the chip, reset it and read the calibration data. iodev comes from
+// I2C_DT_IODEV_DEFINE() on the sensor node, the bus scheduler must be running.
+// Call again after the sensor was replugged, the profile is kept.
+int bme_init(struct rtio_iodev *iodev);
+
+// Takes effect from the next sample
+int bme_set_profile(const struct bme_profile *profile);
+const struct bme_profile *bme_get_profile(void);
+
+// Worst case conversion time for the profile, from the datasheet
+uint32_t bme_measure_time_us(const struct bme_profile *profile);
+
+// Trigger one conversion, sleep through it and read the compensated result.
+// Fills the measurement fields of the sample, a skipped channel reads 0.
+int bme_sample(struct bme280_sample *out);
+
+#endif // BME_H
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#include "fb.h"
+
+/* Scaled glyph tables, built by the compiler from the FONT_5X7 X-macro.
+ SPREADn repeats every bit of a 7 row column n times, the result is cut
+ into n page bytes and every column is repeated n times.*/
+#define BITN(b, k, n) ((uint32_t)(((b) >> (k)) & 1) * (((1u << (n)) - 1) << ((n) * (k))))
+#define SPREAD(b, n) (BITN(b, 0, n) | BITN(b, 1, n) | BITN(b, 2, n) | \
+                      BITN(b, 3, n) | BITN(b, 4, n) | BITN(b, 5, n) | \
+                      BITN(b, 6, n))
+#define PAGE(b, n, p) ((uint8_t)(SPREAD(b, n) >> (8 * (p))))
+
+#define GLYPH1(a, b, c, d, e) { a, b, c, d, e },
+
+#define ROW2(p, a, b, c, d, e) { \
+    PAGE(a, 2, p), PAGE(a, 2, p), PAGE(b, 2, p), PAGE(b, 2, p), \
+    PAGE(c, 2, p), PAGE(c, 2, p), PAGE(d, 2, p), PAGE(d, 2, p), \
+    PAGE(e, 2, p), PAGE(e, 2, p) }
+#define GLYPH2(a, b, c, d, e) { ROW2(0, a, b, c, d, e), ROW2(1, a, b, c, d, e) },
+
+#define ROW3(p, a, b, c, d, e) { \
+    PAGE(a, 3, p), PAGE(a, 3, p), PAGE(a, 3, p), \
+    PAGE(b, 3, p), PAGE(b, 3, p), PAGE(b, 3, p), \
+    PAGE(c, 3, p), PAGE(c, 3, p), PAGE(c, 3, p), \
+    PAGE(d, 3, p), PAGE(d, 3, p), PAGE(d, 3, p), \
+    PAGE(e, 3, p), PAGE(e, 3, p), PAGE(e, 3, p) }
+#define GLYPH3(a, b, c, d, e) { ROW3(0, a, b, c, d, e), ROW3(1, a, b, c, d, e), \
+                                ROW3(2, a, b, c, d, e) },
+
+static const uint8_t font1[FONT_GLYPHS][5] = { FONT_5X7(GLYPH1) };
+static const uint8_t font2[FONT_GLYPHS][2][10] = { FONT_5X7(GLYPH2) };
+static const uint8_t font3[FONT_GLYPHS][3][15] = { FONT_5X7(GLYPH3) };
+
+static uint8_t *fb_byte(int x, int page)
+{
+    return &oled_framebuffer()[page * OLED_WIDTH + x];
+}
+
+void fb_pixel(int x, int y, bool on)
+{
+    if (x < 0 || x >= OLED_WIDTH || y < 0 || y >= OLED_HEIGHT) {
+        return;
+    }
+
+    if (on) {
+        *fb_byte(x, y / 8) |= BIT(y % 8);
+    } else {
+        *fb_byte(x, y / 8) &= ~BIT(y % 8);
+    }
+}
+
+void fb_fill_rect(int x, int y, int w, int h, bool on)
+{
+    int x0 = MAX(x, 0);
+    int x1 = MIN(x + w, OLED_WIDTH);
+    int y0 = MAX(y, 0);
+    int y1 = MIN(y + h, OLED_HEIGHT);
+
+    // Whole columns of a page at a time
+    for (int page = y0 / 8; y0 < y1 && page <= (y1 - 1) / 8; page++) {
+        int top = MAX(y0 - page * 8, 0);
+        int bottom = MIN(y1 - page * 8, 8);
+        uint8_t mask = (uint8_t)(GENMASK(bottom - 1, top));
+
+        for (int i = x0; i < x1; i++) {
+            if (on) {
+                *fb_byte(i, page) |= mask;
+            } else {
+                *fb_byte(i, page) &= ~mask;
+            }
+        }
+    }
+}
+
+void fb_hline(int x, int y, int w, bool on)
+{
+    fb_fill_rect(x, y, w, 1, on);
+}
+
+void fb_vline(int x, int y, int h, bool on)
+{
+    fb_fill_rect(x, y, 1, h, on);
+}
+
+void fb_rect(int x, int y, int w, int h, bool on)
+{
+    fb_hline(x, y, w, on);
+    fb_hline(x, y + h - 1, w, on);
+    fb_vline(x, y, h, on);
+    fb_vline(x + w - 1, y, h, on);
+}
+
+// Bresenham, any direction
+void fb_line(int x0, int y0, int x1, int y1, bool on)
+{
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    while (1) {
+        fb_pixel(x0, y0, on);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void fb_bitmap(int x, int y, int w, int h, const uint8_t *bits)
+{
+    int stride = (w + 7) / 8;
+
+    for (int row = 0; row < h; row++) {
+        for (int col = 0; col < w; col++) {
+            if (bits[row * stride + col / 8] & BIT(7 - col % 8)) {
+                fb_pixel(x + col, y + row, true);
+            }
+        }
+    }
+}
+
+static int glyph_index(char c)
+{
+    if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+    if (c == FONT_DEGREE) {
+        return FONT_GLYPHS - 1;
+    }
+    if (c < FONT_FIRST || c > FONT_LAST) {
+        c = '?';
+    }
+    return c - FONT_FIRST;
+}
+
+static const uint8_t *glyph_page(enum fb_font font, int idx, int page)
+{
+    switch (font) {
+    case FB_FONT_MEDIUM:
+        return font2[idx][page];
+    case FB_FONT_LARGE:
+        return font3[idx][page];
+    default:
+        return font1[idx];
+    }
+}
+
+// OR 8 vertical pixels into column x starting at row y
+static void fb_put_column(int x, int y, uint8_t bits)
+{
+    int page = y >> 3;
+    int shift = y & 7;
+
+    if (x < 0 || x >= OLED_WIDTH || y < 0) {
+        return;
+    }
+    if (page < OLED_PAGES) {
+        *fb_byte(x, page) |= bits << shift;
+    }
+    if (shift && page + 1 < OLED_PAGES) {
+        *fb_byte(x, page + 1) |= bits >> (8 - shift);
+    }
+}
+
+int fb_text_width(enum fb_font font, const char *str)
+{
+    return strlen(str) * FB_CELL_W(font);
+}
+
+int fb_text(int x, int y, enum fb_font font, const char *str)
+{
+    int glyph_w = 5 * font;
+    int start = x;
+
+    fb_fill_rect(x, y, fb_text_width(font, str), FB_CELL_H(font), false);
+
+    for (; *str; str++, x += FB_CELL_W(font)) {
+        int idx = glyph_index(*str);
+
+        for (int page = 0; page < (int)font; page++) {
+            const uint8_t *cols = glyph_page(font, idx, page);
+
+            for (int col = 0; col < glyph_w; col++) {
+                fb_put_column(x + col, y + page * 8, cols[col]);
+            }
+        }
+    }
+    return x - start;
+}
+
+int fb_number(int x, int y, enum fb_font font, int32_t milli, int decimals,
+              const char *unit)
+{
+    static const uint32_t pow10[] = { 1, 10, 100, 1000 };
+    char buf[24];
+
+    decimals = CLAMP(decimals, 0, 3);
+
+    uint32_t div = pow10[3 - decimals];
+    uint32_t mag = milli < 0 ? -(int64_t)milli : milli;
+    uint32_t rounded = (mag + div / 2) / div;
+    uint32_t ipart = rounded / pow10[decimals];
+    uint32_t fpart = rounded % pow10[decimals];
+    const char *sign = (milli < 0 && rounded) ? "-" : "";
+
+    if (decimals) {
+        snprintf(buf, sizeof(buf), "%s%u.%0*u%s", sign, ipart, decimals, fpart,
+                 unit ? unit : "");
+    } else {
+        snprintf(buf, sizeof(buf), "%s%u%s", sign, ipart, unit ? unit : "");
+    }
+
+    return fb_text(x, y, font, buf);
+}
@@ -0,0 +1,45 @@
+#ifndef FB_H
+#define FB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "oled.h"
+#include "font.h"
+
+/* 1bpp drawing on the oled.c framebuffer (OLED_WIDTH x OLED_HEIGHT).
+ Everything is clipped to the panel. Text drawn at a y that is a multiple of
+ 8 lands on whole SSD1306 pages, so it is copied without bit shifting and a
+ changed line costs one write per page at flush time.*/
+
+// Font sizes, the value is the scale of the 5x7 base font
+enum fb_font {
+    FB_FONT_SMALL = 1,          // 5x7 in a 6x8 cell
+    FB_FONT_MEDIUM = 2,         // 10x14 in a 12x16 cell
+    FB_FONT_LARGE = 3,          // 15x21 in an 18x24 cell
+};
+
+#define FB_CELL_W(font) (6 * (font))
+#define FB_CELL_H(font) (8 * (font))
+
+void fb_pixel(int x, int y, bool on);
+void fb_hline(int x, int y, int w, bool on);
+void fb_vline(int x, int y, int h, bool on);
+void fb_line(int x0, int y0, int x1, int y1, bool on);
+void fb_rect(int x, int y, int w, int h, bool on);
+void fb_fill_rect(int x, int y, int w, int h, bool on);
+
+// Set the pixels of a w x h bitmap, rows top to bottom, MSB first, each row
+// padded to a whole byte
+void fb_bitmap(int x, int y, int w, int h, const uint8_t *bits);
+
+// Draw text over a cleared background, returns the width in pixels
+int fb_text(int x, int y, enum fb_font font, const char *str);
+int fb_text_width(enum fb_font font, const char *str);
+
+// Draw a fixed point value given in thousandths, rounded to 0-3 decimals and
+// followed by an optional unit. Returns the width in pixels.
+int fb_number(int x, int y, enum fb_font font, int32_t milli, int decimals,
+              const char *unit);
+
+#endif // FB_H
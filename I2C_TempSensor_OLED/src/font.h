@@ -0,0 +1,78 @@
+#ifndef FONT_H
+#define FONT_H
+
+/* 5x7 base font, ASCII ' ' to 'Z' followed by a degree sign.
+ One byte per column, bit 0 is the top row, which is the SSD1306 page
+ layout, so glyphs go to the panel without any transposing. Lower case
+ letters are drawn as upper case.
+
+ The table is an X-macro: fb.c expands it once per font size, scaling each
+ column at compile time, so the larger sizes cost no code or RAM.*/
+#define FONT_FIRST ' '
+#define FONT_LAST 'Z'
+#define FONT_DEGREE '\177'      // "\177" in strings, octal so it cannot swallow a following digit
+#define FONT_GLYPHS (FONT_LAST - FONT_FIRST + 2)
+
+#define FONT_5X7(G) \
+    G(0x00, 0x00, 0x00, 0x00, 0x00) /*   */ \
+    G(0x00, 0x00, 0x5f, 0x00, 0x00) /* ! */ \
+    G(0x00, 0x03, 0x00, 0x03, 0x00) /* " */ \
+    G(0x22, 0x7f, 0x22, 0x7f, 0x22) /* # */ \
+    G(0x24, 0x2a, 0x7f, 0x2a, 0x12) /* $ */ \
+    G(0x23, 0x13, 0x08, 0x64, 0x62) /* % */ \
+    G(0x36, 0x49, 0x55, 0x22, 0x50) /* & */ \
+    G(0x00, 0x00, 0x03, 0x00, 0x00) /* ' */ \
+    G(0x00, 0x1c, 0x22, 0x41, 0x00) /* ( */ \
+    G(0x00, 0x41, 0x22, 0x1c, 0x00) /* ) */ \
+    G(0x14, 0x08, 0x3e, 0x08, 0x14) /* * */ \
+    G(0x08, 0x08, 0x3e, 0x08, 0x08) /* + */ \
+    G(0x00, 0x50, 0x30, 0x00, 0x00) /* , */ \
+    G(0x08, 0x08, 0x08, 0x08, 0x08) /* - */ \
+    G(0x00, 0x60, 0x60, 0x00, 0x00) /* . */ \
+    G(0x20, 0x10, 0x08, 0x04, 0x02) /* / */ \
+    G(0x3e, 0x51, 0x49, 0x45, 0x3e) /* 0 */ \
+    G(0x00, 0x42, 0x7f, 0x40, 0x00) /* 1 */ \
+    G(0x42, 0x61, 0x51, 0x49, 0x46) /* 2 */ \
+    G(0x21, 0x41, 0x45, 0x4b, 0x31) /* 3 */ \
+    G(0x18, 0x14, 0x12, 0x7f, 0x10) /* 4 */ \
+    G(0x27, 0x45, 0x45, 0x45, 0x39) /* 5 */ \
+    G(0x3c, 0x4a, 0x49, 0x49, 0x30) /* 6 */ \
+    G(0x01, 0x71, 0x09, 0x05, 0x03) /* 7 */ \
+    G(0x36, 0x49, 0x49, 0x49, 0x36) /* 8 */ \
+    G(0x06, 0x49, 0x49, 0x29, 0x1e) /* 9 */ \
+    G(0x00, 0x36, 0x36, 0x00, 0x00) /* : */ \
+    G(0x00, 0x56, 0x36, 0x00, 0x00) /* ; */ \
+    G(0x08, 0x14, 0x22, 0x41, 0x00) /* < */ \
+    G(0x14, 0x14, 0x14, 0x14, 0x14) /* = */ \
+    G(0x00, 0x41, 0x22, 0x14, 0x08) /* > */ \
+    G(0x02, 0x01, 0x51, 0x09, 0x06) /* ? */ \
+    G(0x32, 0x49, 0x79, 0x41, 0x3e) /* @ */ \
+    G(0x7e, 0x09, 0x09, 0x09, 0x7e) /* A */ \
+    G(0x7f, 0x49, 0x49, 0x49, 0x36) /* B */ \
+    G(0x3e, 0x41, 0x41, 0x41, 0x22) /* C */ \
+    G(0x7f, 0x41, 0x41, 0x22, 0x1c) /* D */ \
+    G(0x7f, 0x49, 0x49, 0x49, 0x41) /* E */ \
+    G(0x7f, 0x09, 0x09, 0x09, 0x01) /* F */ \
+    G(0x3e, 0x41, 0x49, 0x49, 0x7a) /* G */ \
+    G(0x7f, 0x08, 0x08, 0x08, 0x7f) /* H */ \
+    G(0x00, 0x41, 0x7f, 0x41, 0x00) /* I */ \
+    G(0x20, 0x40, 0x41, 0x3f, 0x01) /* J */ \
+    G(0x7f, 0x08, 0x14, 0x22, 0x41) /* K */ \
+    G(0x7f, 0x40, 0x40, 0x40, 0x40) /* L */ \
+    G(0x7f, 0x02, 0x0c, 0x02, 0x7f) /* M */ \
+    G(0x7f, 0x04, 0x08, 0x10, 0x7f) /* N */ \
+    G(0x3e, 0x41, 0x41, 0x41, 0x3e) /* O */ \
+    G(0x7f, 0x09, 0x09, 0x09, 0x06) /* P */ \
+    G(0x3e, 0x41, 0x51, 0x21, 0x5e) /* Q */ \
+    G(0x7f, 0x09, 0x19, 0x29, 0x46) /* R */ \
+    G(0x46, 0x49, 0x49, 0x49, 0x31) /* S */ \
+    G(0x01, 0x01, 0x7f, 0x01, 0x01) /* T */ \
+    G(0x3f, 0x40, 0x40, 0x40, 0x3f) /* U */ \
+    G(0x1f, 0x20, 0x40, 0x20, 0x1f) /* V */ \
+    G(0x3f, 0x40, 0x38, 0x40, 0x3f) /* W */ \
+    G(0x63, 0x14, 0x08, 0x14, 0x63) /* X */ \
+    G(0x03, 0x04, 0x78, 0x04, 0x03) /* Y */ \
+    G(0x61, 0x51, 0x49, 0x45, 0x43) /* Z */ \
+    G(0x06, 0x09, 0x09, 0x06, 0x00) /* degree */
+
+#endif // FONT_H
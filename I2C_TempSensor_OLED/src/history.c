@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <zephyr/sys/util.h>
+
+#include "history.h"
+#include "fb.h"
+
+static int32_t values[HISTORY_LEN];     // Column averages, index = column
+static int count;                       // Valid entries
+static int cursor;                      // Column written next
+
+static int graph_y;
+static int graph_h;
+static int32_t window_lo;               // Value at the bottom row
+
+static int64_t acc;
+static int acc_n;
+
+static struct history_stats stats;
+
+void history_init(int y, int h)
+{
+    graph_y = y;
+    graph_h = h;
+    count = 0;
+    cursor = 0;
+    acc = 0;
+    acc_n = 0;
+    fb_fill_rect(0, graph_y, HISTORY_LEN, graph_h, false);
+}
+
+static int value_row(int32_t v)
+{
+    int64_t r = (int64_t)(v - window_lo) * (graph_h - 1) / HISTORY_SPAN;
+
+    return graph_y + graph_h - 1 - CLAMP((int)r, 0, graph_h - 1);
+}
+
+// Draw one column, joined to the previous one by a vertical segment
+static void draw_column(int x)
+{
+    int prev = (x + HISTORY_LEN - 1) % HISTORY_LEN;
+    int y = value_row(values[x]);
+    int y0 = y;
+
+    fb_vline(x, graph_y, graph_h, false);
+
+    // The first column after the gap has no neighbour to join
+    if (x != (cursor + HISTORY_GAP) % HISTORY_LEN && (x != 0 || count == HISTORY_LEN)) {
+        y0 = value_row(values[prev]);
+    }
+    fb_vline(x, MIN(y, y0), abs(y - y0) + 1, true);
+}
+
+// Centre the window on v at a whole multiple of 1000, then redraw every column
+static void rescale(int32_t v)
+{
+    int32_t lo = v - HISTORY_SPAN / 2 + 500;
+
+    window_lo = lo - ((lo % 1000) + 1000) % 1000;
+    if (v < window_lo || v > window_lo + HISTORY_SPAN) {
+        window_lo = v - HISTORY_SPAN / 2;
+    }
+    stats.rescales++;
+
+    fb_fill_rect(0, graph_y, HISTORY_LEN, graph_h, false);
+    for (int i = 0; i < count; i++) {
+        int x = (cursor + HISTORY_LEN - count + i) % HISTORY_LEN;
+
+        if ((x - cursor + HISTORY_LEN) % HISTORY_LEN >= HISTORY_GAP) {
+            draw_column(x);
+        }
+    }
+}
+
+bool history_add(int32_t value)
+{
+    acc += value;
+    if (++acc_n < HISTORY_SAMPLES_PER_COLUMN) {
+        return false;
+    }
+
+    int32_t v = (int32_t)(acc / acc_n);
+
+    acc = 0;
+    acc_n = 0;
+
+    values[cursor] = v;
+    count = MIN(count + 1, HISTORY_LEN);
+    cursor = (cursor + 1) % HISTORY_LEN;
+    stats.columns++;
+
+    if (stats.columns == 1 || v < window_lo || v > window_lo + HISTORY_SPAN) {
+        rescale(v);
+    } else {
+        draw_column((cursor + HISTORY_LEN - 1) % HISTORY_LEN);
+    }
+
+    // Keep the gap ahead of the cursor blank, the oldest column left after it
+    // loses the segment joining it to the column just blanked
+    for (int i = 0; i < HISTORY_GAP; i++) {
+        fb_vline((cursor + i) % HISTORY_LEN, graph_y, graph_h, false);
+    }
+    if (count >= HISTORY_LEN - HISTORY_GAP) {
+        draw_column((cursor + HISTORY_GAP) % HISTORY_LEN);
+    }
+    return true;
+}
+
+void history_stats_get(struct history_stats *out)
+{
+    *out = stats;
+}
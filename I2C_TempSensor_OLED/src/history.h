@@ -0,0 +1,44 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "oled.h"
+
+/* Sample history drawn as a graph into the oled.c framebuffer.
+ One entry per screen column: entry i is always drawn in column i, and a
+ cursor sweeps left to right with a short blank gap ahead of it marking the
+ oldest data. A new column rewrites only the cursor and gap columns, so the
+ panel traffic per column is the same however much history is shown.*/
+
+#define HISTORY_LEN OLED_WIDTH
+
+// Samples averaged into one column
+#ifndef HISTORY_SAMPLES_PER_COLUMN
+#define HISTORY_SAMPLES_PER_COLUMN 4
+#endif
+
+// Value range covered by the graph height, in the units passed to
+// history_add(). The window only moves when a value falls outside it.
+#ifndef HISTORY_SPAN
+#define HISTORY_SPAN 4000
+#endif
+
+// Blank columns ahead of the cursor
+#define HISTORY_GAP 2
+
+struct history_stats {
+    uint32_t columns;           // Columns completed
+    uint32_t rescales;          // Window moves, each redraws the whole graph
+};
+
+// Use rows [y, y + h) of the framebuffer for the graph
+void history_init(int y, int h);
+
+// Add a sample. Returns true when the framebuffer changed.
+bool history_add(int32_t value);
+
+void history_stats_get(struct history_stats *out);
+
+#endif // HISTORY_H
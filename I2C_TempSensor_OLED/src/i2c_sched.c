@@ -0,0 +1,162 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/rtio/rtio.h>
+
+#include "i2c_sched.h"
+
+#define I2C_SCHED_STACK_SIZE 1024
+#define I2C_SCHED_PRIORITY 5        // Above the sensor and display threads
+
+// One job in flight, one SQE per message
+RTIO_DEFINE(i2c_rtio, I2C_JOB_MAX_MSGS, I2C_JOB_MAX_MSGS);
+
+K_THREAD_STACK_DEFINE(sched_stack, I2C_SCHED_STACK_SIZE);
+static struct k_thread sched_thread;
+
+// Waiting jobs, one FIFO per priority
+static sys_slist_t queues[I2C_PRIO_COUNT];
+static struct k_spinlock lock;
+static K_SEM_DEFINE(pending, 0, K_SEM_MAX_LIMIT);
+
+static struct i2c_sched_stats stats;
+
+// Used by i2c_sched_run() to wait for its job
+struct sync_wait {
+    struct k_sem done;
+    int result;
+};
+
+static struct i2c_job *next_job(void)
+{
+    struct i2c_job *job = NULL;
+
+    K_SPINLOCK(&lock) {
+        for (int p = 0; p < I2C_PRIO_COUNT && job == NULL; p++) {
+            sys_snode_t *node = sys_slist_get(&queues[p]);
+
+            if (node != NULL) {
+                job = CONTAINER_OF(node, struct i2c_job, node);
+            }
+        }
+    }
+    return job;
+}
+
+// Run the messages as one transaction and collect the result
+static int run_job(struct i2c_job *job)
+{
+    struct rtio_cqe *cqe;
+    int ret = 0;
+
+    if (i2c_rtio_copy(&i2c_rtio, job->iodev, job->msgs, job->num_msgs) == NULL) {
+        rtio_sqe_drop_all(&i2c_rtio);
+        return -ENOMEM;
+    }
+
+    rtio_submit(&i2c_rtio, 1);
+
+    while ((cqe = rtio_cqe_consume(&i2c_rtio)) != NULL) {
+        if (ret == 0) {
+            ret = cqe->result;
+        }
+        rtio_cqe_release(&i2c_rtio, cqe);
+    }
+    return ret;
+}
+
+// Scheduler thread start function
+static void sched_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    while (1) {
+        k_sem_take(&pending, K_FOREVER);
+
+        struct i2c_job *job = next_job();
+
+        if (job == NULL) {
+            continue;
+        }
+
+        uint32_t start = k_cycle_get_32();
+        int ret = run_job(job);
+        uint32_t wait_us = k_cyc_to_us_floor32(start - job->queued_cyc);
+        uint32_t busy_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+        K_SPINLOCK(&lock) {
+            struct i2c_sched_prio_stats *ps = &stats.prio[job->prio];
+
+            ps->jobs++;
+            ps->errors += ret != 0;
+            ps->max_wait_us = MAX(ps->max_wait_us, wait_us);
+            stats.max_job_us = MAX(stats.max_job_us, busy_us);
+        }
+
+        job->cb(job, ret);
+    }
+}
+
+int i2c_sched_start(void)
+{
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+        sys_slist_init(&queues[p]);
+    }
+
+    k_thread_create(&sched_thread,
+                    sched_stack,
+                    K_THREAD_STACK_SIZEOF(sched_stack),
+                    sched_thread_start,
+                    NULL, NULL, NULL,
+                    I2C_SCHED_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&sched_thread, "i2c_sched");
+    return 0;
+}
+
+int i2c_sched_submit(struct i2c_job *job)
+{
+    if (job->prio >= I2C_PRIO_COUNT || job->num_msgs == 0 ||
+        job->num_msgs > I2C_JOB_MAX_MSGS || job->cb == NULL) {
+        return -EINVAL;
+    }
+
+    job->queued_cyc = k_cycle_get_32();
+    K_SPINLOCK(&lock) {
+        sys_slist_append(&queues[job->prio], &job->node);
+    }
+    k_sem_give(&pending);
+    return 0;
+}
+
+static void sync_done(struct i2c_job *job, int result)
+{
+    struct sync_wait *w = job->user_data;
+
+    w->result = result;
+    k_sem_give(&w->done);
+}
+
+int i2c_sched_run(struct i2c_job *job)
+{
+    struct sync_wait w;
+    int ret;
+
+    k_sem_init(&w.done, 0, 1);
+    job->cb = sync_done;
+    job->user_data = &w;
+
+    ret = i2c_sched_submit(job);
+    if (ret) {
+        return ret;
+    }
+
+    k_sem_take(&w.done, K_FOREVER);
+    return w.result;
+}
+
+void i2c_sched_stats_get(struct i2c_sched_stats *out)
+{
+    K_SPINLOCK(&lock) {
+        *out = stats;
+    }
+}
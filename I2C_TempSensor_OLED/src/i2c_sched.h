@@ -0,0 +1,63 @@
+#ifndef I2C_SCHED_H
+#define I2C_SCHED_H
+
+#include <stdint.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/sys/slist.h>
+
+/* Owner of the shared I2C bus. Clients queue jobs, each an I2C transaction
+ to one device, and get a callback when it is done. A single thread runs the
+ jobs one at a time through RTIO, always taking the highest priority job
+ waiting, so a queued sensor read waits for at most the job already on the
+ bus. Long transfers should be split into several jobs (the display queues
+ one job per page) to keep that wait short.*/
+
+enum i2c_sched_prio {
+    I2C_PRIO_HIGH = 0,          // Sensor reads
+    I2C_PRIO_LOW,               // Display updates
+    I2C_PRIO_IDLE,              // Presence probes, only run on an idle bus
+    I2C_PRIO_COUNT,
+};
+
+#define I2C_JOB_MAX_MSGS 8
+
+struct i2c_job;
+
+// Called from the scheduler thread, may queue further jobs
+typedef void (*i2c_job_cb_t)(struct i2c_job *job, int result);
+
+struct i2c_job {
+    sys_snode_t node;
+    struct rtio_iodev *iodev;   // From I2C_DT_IODEV_DEFINE()
+    struct i2c_msg msgs[I2C_JOB_MAX_MSGS];
+    uint8_t num_msgs;
+    uint8_t prio;               // enum i2c_sched_prio
+    i2c_job_cb_t cb;
+    void *user_data;
+    uint32_t queued_cyc;        // Set by i2c_sched_submit()
+};
+
+struct i2c_sched_prio_stats {
+    uint32_t jobs;
+    uint32_t errors;
+    uint32_t max_wait_us;       // Longest time from submit to start
+};
+
+struct i2c_sched_stats {
+    struct i2c_sched_prio_stats prio[I2C_PRIO_COUNT];
+    uint32_t max_job_us;        // Longest job on the bus
+};
+
+int i2c_sched_start(void);
+
+// Queue a job. Never blocks, the job must stay untouched until its
+// callback ran.
+int i2c_sched_submit(struct i2c_job *job);
+
+// Queue a job and wait for it, returns the transfer result
+int i2c_sched_run(struct i2c_job *job);
+
+void i2c_sched_stats_get(struct i2c_sched_stats *out);
+
+#endif // I2C_SCHED_H
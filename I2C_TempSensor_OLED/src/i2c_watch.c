@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "i2c_watch.h"
+#include "i2c_sched.h"
+#include "i2c_probe.h"
+
+#define I2C_WATCH_STACK_SIZE 1024
+#define I2C_WATCH_PRIORITY 9        // Below the sensor and display threads
+
+ZBUS_CHAN_DEFINE(i2c_watch_chan,
+                 struct i2c_watch_state,
+                 NULL,                  // No validator
+                 NULL,                  // No user data
+                 ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+
+K_THREAD_STACK_DEFINE(watch_stack, I2C_WATCH_STACK_SIZE);
+static struct k_thread watch_thread;
+
+static const struct i2c_watch_dev *watched;
+static int watched_count;
+
+static struct i2c_watch_state state;
+static uint8_t misses[I2C_WATCH_MAX_DEVS];
+
+static struct i2c_job job;
+static uint8_t probe_buf;
+
+static struct k_spinlock lock;
+static struct i2c_watch_stats stats;
+
+static bool probe(const struct i2c_watch_dev *dev)
+{
+    uint16_t addr = ((const struct i2c_dt_spec *)dev->iodev->data)->addr;
+
+    job.iodev = dev->iodev;
+    job.num_msgs = 1;
+    job.prio = I2C_PRIO_IDLE;
+    i2c_probe_msg(addr, &job.msgs[0], &probe_buf);
+
+    return i2c_sched_run(&job) == 0;
+}
+
+// Returns true if the device changed state
+static bool update(int i, bool ack)
+{
+    bool present = state.present & BIT(i);
+
+    if (ack) {
+        misses[i] = 0;
+        if (present) {
+            return false;
+        }
+        state.present |= BIT(i);
+        state.attaches[i]++;
+        K_SPINLOCK(&lock) {
+            stats.attaches++;
+        }
+        printk("I2C watch: %s attached\n", watched[i].name);
+        return true;
+    }
+
+    if (!present || ++misses[i] < I2C_WATCH_MISSES) {
+        return false;
+    }
+    state.present &= ~BIT(i);
+    K_SPINLOCK(&lock) {
+        stats.detaches++;
+    }
+    printk("I2C watch: %s detached\n", watched[i].name);
+    return true;
+}
+
+// Watcher thread start function
+static void watch_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    int64_t next_ms = k_uptime_get();
+
+    while (1) {
+        bool changed = false;
+
+        for (int i = 0; i < watched_count; i++) {
+            bool ack = probe(&watched[i]);
+
+            K_SPINLOCK(&lock) {
+                stats.probes++;
+            }
+            changed |= update(i, ack);
+        }
+
+        // One publication for all changes of a round
+        if (changed) {
+            zbus_chan_pub(&i2c_watch_chan, &state, K_MSEC(100));
+        }
+
+        next_ms += I2C_WATCH_PERIOD_MS;
+        k_sleep(K_TIMEOUT_ABS_MS(next_ms));
+    }
+}
+
+int i2c_watch_start(const struct i2c_watch_dev *devs, int count)
+{
+    if (count <= 0 || count > I2C_WATCH_MAX_DEVS) {
+        return -EINVAL;
+    }
+
+    watched = devs;
+    watched_count = count;
+    state.present = BIT_MASK(count);
+    zbus_chan_pub(&i2c_watch_chan, &state, K_MSEC(100));
+
+    k_thread_create(&watch_thread,
+                    watch_stack,
+                    K_THREAD_STACK_SIZEOF(watch_stack),
+                    watch_thread_start,
+                    NULL, NULL, NULL,
+                    I2C_WATCH_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&watch_thread, "i2c_watch");
+    return 0;
+}
+
+void i2c_watch_stats_get(struct i2c_watch_stats *out)
+{
+    K_SPINLOCK(&lock) {
+        *out = stats;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef I2C_WATCH_H
+#define I2C_WATCH_H
+
+#include <stdint.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/zbus/zbus.h>
+
+/* Hot-plug watcher for the devices the app expects on the bus. Every
+ I2C_WATCH_PERIOD_MS each device gets the bus scanner's probe (one address
+ byte) as an idle priority job, so it never delays sensor or display
+ traffic. A device is reported gone after I2C_WATCH_MISSES failed probes in
+ a row and back on the first probe it answers again. Changes are published
+ on i2c_watch_chan, the owner of each device re-initialises it.*/
+
+#define I2C_WATCH_MAX_DEVS 8
+#define I2C_WATCH_PERIOD_MS 1000
+#define I2C_WATCH_MISSES 2
+
+struct i2c_watch_dev {
+    const char *name;
+    struct rtio_iodev *iodev;   // From I2C_DT_IODEV_DEFINE()
+};
+
+// Published on every change. Only the latest state is kept, so consumers
+// compare attach counts instead of counting notifications: a device that
+// was unplugged and replugged between two reads has a new count.
+struct i2c_watch_state {
+    uint32_t present;                       // Bit per device, in table order
+    uint16_t attaches[I2C_WATCH_MAX_DEVS];  // Times each device came back
+};
+
+ZBUS_CHAN_DECLARE(i2c_watch_chan);
+
+struct i2c_watch_stats {
+    uint32_t probes;
+    uint32_t detaches;
+    uint32_t attaches;
+};
+
+// Watch devs[0..count-1], all taken as present at start. The table must
+// stay valid, the bus scheduler must be running.
+int i2c_watch_start(const struct i2c_watch_dev *devs, int count);
+
+void i2c_watch_stats_get(struct i2c_watch_stats *out);
+
+#endif // I2C_WATCH_H
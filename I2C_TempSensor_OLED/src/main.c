@@ -1,41 +1,32 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zephyr/kernel.h> // Contains the threading fucntions and mutex functions--> also timing macros
 #include <zephyr/device.h> // Device onfigurations
-#include <zephyr/drivers/sensor.h> // BME280 implements this API
+#include <zephyr/drivers/i2c.h> // Both devices share one I2C bus
+#include <zephyr/rtio/rtio.h> // Queued bus transactions
 #include <zephyr/drivers/display.h> // SSD1306 implements this API
+#include <zephyr/zbus/zbus.h> // Publish/subscribe channels between the threads
 
+#include "sensor_bus.h"
+#include "bme.h"
+#include "i2c_sched.h"
+#include "oled.h"
+#include "fb.h"
+#include "history.h"
+#include "i2c_watch.h"
 
-// Define the sleep time used in the threads
-static const int32_t sensor_sleep_ms = 500;
-static const int32_t display_sleep_ms = 1000;
 
-// Sleep time for the sensor capture
-static const int32_t sleep_time_ms = 1000;
+// Sampling profile: bme_profile_low_noise, bme_profile_fast or
+// bme_profile_weather (oversampling, IIR filter and sample period)
+#define SENSOR_PROFILE bme_profile_low_noise
 
-static uint8_t oled_buf[128];  // 1 page = 8px height
-
-static int temp_int;   // shared temperature (integer °C)
-
-/* A hard‑coded 8×8 pixel font for numbers
- Each digit (0–9) is drawn as an 8‑byte, 8‑pixel‑tall pattern.
-Every byte represents one row of pixels, and each bit in that byte is on/off for the OLED*/
-
-static const uint8_t digit_font[10][8] = {
-    {0x3C,0x66,0x6E,0x76,0x66,0x66,0x3C,0x00}, // 0
-    {0x18,0x38,0x18,0x18,0x18,0x18,0x3C,0x00}, // 1
-    {0x3C,0x66,0x06,0x0C,0x18,0x30,0x7E,0x00}, // 2
-    {0x3C,0x66,0x06,0x1C,0x06,0x66,0x3C,0x00}, // 3
-    {0x0C,0x1C,0x3C,0x6C,0x7E,0x0C,0x0C,0x00}, // 4
-    {0x7E,0x60,0x7C,0x06,0x06,0x66,0x3C,0x00}, // 5
-    {0x1C,0x30,0x60,0x7C,0x66,0x66,0x3C,0x00}, // 6
-    {0x7E,0x66,0x06,0x0C,0x18,0x18,0x18,0x00}, // 7
-    {0x3C,0x66,0x66,0x3C,0x66,0x66,0x3C,0x00}, // 8
-    {0x3C,0x66,0x66,0x3E,0x06,0x0C,0x38,0x00}  // 9
-};
+// Period of the bus statistics printout
+static const int32_t sleep_time_ms = 10000;
 
 // Define the stack size of each thread
-#define SENSOR_THREAD_STACK_SIZE 512
-#define DISPLAY_THREAD_STACK_SIZE 512
+#define SENSOR_THREAD_STACK_SIZE 1024
+#define DISPLAY_THREAD_STACK_SIZE 1024
 
 // Define stack areas for both the threads
 K_THREAD_STACK_DEFINE(sensor_stack, SENSOR_THREAD_STACK_SIZE);
@@ -45,72 +36,188 @@ K_THREAD_STACK_DEFINE(display_stack, DISPLAY_THREAD_STACK_SIZE);
 static struct k_thread sensor_thread;
 static struct k_thread display_thread;
 
-// Define mutex
-K_MUTEX_DEFINE(temp_mutex);
+// The display thread is woken by every new sample on the bus
+ZBUS_SUBSCRIBER_DEFINE(display_sub, 4);
+ZBUS_CHAN_ADD_OBS(bme280_chan, display_sub, 3);
+
+// Both threads are woken when a device is unplugged or comes back
+ZBUS_SUBSCRIBER_DEFINE(sensor_sub, 4);
+ZBUS_CHAN_ADD_OBS(i2c_watch_chan, sensor_sub, 3);
+ZBUS_CHAN_ADD_OBS(i2c_watch_chan, display_sub, 4);
 
 //Get device configurations
-static const struct device *const bme280 = DEVICE_DT_GET(DT_ALIAS(my_temp));
 static const struct device *const ssd1306 = DEVICE_DT_GET(DT_ALIAS(my_disp));
 
+// Bus endpoints for the I2C scheduler
+I2C_DT_IODEV_DEFINE(bme280_iodev, DT_ALIAS(my_temp));
+I2C_DT_IODEV_DEFINE(ssd1306_iodev, DT_ALIAS(my_disp));
+
+// Devices checked by the hot-plug watcher
+enum { WATCH_BME280, WATCH_SSD1306 };
+
+static const struct i2c_watch_dev watched[] = {
+    [WATCH_BME280] = { "bme280", &bme280_iodev },
+    [WATCH_SSD1306] = { "ssd1306", &ssd1306_iodev },
+};
+
+// Boot init results, each thread takes over its device's state from here
+static bool sensor_ok;
+static bool panel_ok;
+
+// Profile in use, SENSOR_PROFILE until the sensor was first set up. A
+// profile switched with bme_set_profile() at run time stays in use.
+static const struct bme_profile *sensor_profile(void)
+{
+    const struct bme_profile *p = bme_get_profile();
+
+    return p != NULL ? p : &SENSOR_PROFILE;
+}
+
+// Reset the sensor, at boot and after a replug. bme_init() keeps the
+// profile in use, only the first successful init applies SENSOR_PROFILE.
+static int sensor_init(void)
+{
+    bool first = bme_get_profile() == NULL;
+    int ret = bme_init(&bme280_iodev);
+
+    if (ret == 0 && first) {
+        ret = bme_set_profile(&SENSOR_PROFILE);
+    }
+    return ret;
+}
+
+// Read the watcher state for one device. Returns true if it came back since
+// the caller last looked (*seen) and needs a re-init.
+static bool device_replugged(int dev, uint16_t *seen, bool *present)
+{
+    struct i2c_watch_state ws;
+
+    zbus_chan_read(&i2c_watch_chan, &ws, K_MSEC(100));
+    *present = ws.present & BIT(dev);
+    if (!*present || ws.attaches[dev] == *seen) {
+        return false;
+    }
+    *seen = ws.attaches[dev];
+    return true;
+}
+
 // Sensor thread start function 
 void sensor_thread_start(void *arg_1, void *arg_2, void *arg_3)
 {
     int ret;
-    struct sensor_value temp;
+    struct bme280_sample sample = { 0 };
+    int64_t next_ms = k_uptime_get();
+    const struct zbus_channel *chan;
+    bool ready = sensor_ok;
+    bool present;
+    uint16_t seen = 0;
+
     while(1){
 
-        // Use the sensor sample fetch rather than the bme280 dedicated function
-        ret = sensor_sample_fetch(bme280);
-        if(ret < 0){
-            printk("Sample Fetch Error: %d\n", ret);
+        // Sleep until the next sample is due, a hot-plug change wakes it early
+        if (zbus_sub_wait(&sensor_sub, &chan, K_TIMEOUT_ABS_MS(next_ms)) == 0) {
+            if (device_replugged(WATCH_BME280, &seen, &present)) {
+                ready = sensor_init() == 0;
+                printk("BME280 re-init %s\n", ready ? "done" : "failed");
+            } else if (!present) {
+                ready = false;
+            }
             continue;
         }
 
-        ret = sensor_channel_get(bme280, SENSOR_CHAN_AMBIENT_TEMP, &temp);
-        if(ret < 0){
-            printk("Channel Get Error: %d\n", ret);
+        // Stay on the period grid whatever the conversion time
+        next_ms += sensor_profile()->period_ms;
+
+        // Unplugged, the watcher reports when it is back
+        if(!ready){
             continue;
         }
-        // Lock the mutex variable which is the temp.val1 accessed by both the threads
-        k_mutex_lock(&temp_mutex, K_FOREVER);
-        temp_int = temp.val1;
-        k_mutex_unlock(&temp_mutex);
-        printk("Temperature: %d.%06d\n", temp.val1, temp.val2);
-        k_msleep(sensor_sleep_ms);
+
+        // One forced conversion, the sensor sleeps again until the next one
+        ret = bme_sample(&sample);
+        if(ret < 0){
+            printk("Sample Error: %d\n", ret);
+        } else {
+            sample.timestamp_ms = k_uptime_get();
+            sample.seq++;
+
+            // Every observer gets the full sample, nothing is shared by hand
+            zbus_chan_pub(&bme280_chan, &sample, K_MSEC(100));
+
+            printk("Temperature: %s%d.%03d\n", sample.temp_mc < 0 ? "-" : "",
+                   abs(sample.temp_mc) / 1000, abs(sample.temp_mc) % 1000);
+        }
     }
 }
 
+// Screen layout: readouts on pages 0-1, history graph below the rule
+#define READOUT_H 16
+#define GRAPH_Y 18
+
 // Display thread start function
 void display_thread_start(void *arg_1, void *arg_2, void *arg_3)
 {
-     while (1) {
-        int local_temp;
+    const struct zbus_channel *chan;
+    struct bme280_sample sample;
+    bool drawn = false;
+    int32_t shown[3] = { 0 };
+    bool panel = panel_ok;
+    bool present;
+    uint16_t seen = 0;
+
+    fb_hline(0, READOUT_H, OLED_WIDTH, true);
+    history_init(GRAPH_Y, OLED_HEIGHT - GRAPH_Y);
 
-        k_mutex_lock(&temp_mutex, K_FOREVER);
-        local_temp = temp_int;
-        k_mutex_unlock(&temp_mutex);
+     while (1) {
+        // Sleep until the sensor publishes
+        if (zbus_sub_wait(&display_sub, &chan, K_FOREVER) != 0)
+            continue;
 
-        memset(oled_buf, 0x00, sizeof(oled_buf)); // Clears the OLED display
+        // A replugged panel is blank and unconfigured: set it up again and
+        // send the whole frame, which kept being drawn while it was away
+        if (chan == &i2c_watch_chan) {
+            if (device_replugged(WATCH_SSD1306, &seen, &present)) {
+                panel = oled_panel_init() == 0;
+                printk("SSD1306 re-init %s\n", panel ? "done" : "failed");
+                if (panel)
+                    oled_flush();
+            } else if (!present) {
+                panel = false;
+            }
+            continue;
+        }
 
-        // Extract the digits from the temprature value
-        int tens = (local_temp / 10) % 10; 
-        int ones = local_temp % 10;
+        zbus_chan_read(&bme280_chan, &sample, K_MSEC(100));
 
-        // Copies the 8×8 bitmap for each digit into the display buffe
-        memcpy(&oled_buf[0], digit_font[tens], 8);
-        memcpy(&oled_buf[8], digit_font[ones], 8);
+        // The graph only touches the newest columns
+        bool changed = history_add(sample.temp_mc);
 
-        // Describes the buffer to the SSD1306 driver
-        struct display_buffer_descriptor desc = {
-            .width = 128,
-            .height = 8,
-            .pitch = 128,
-            .buf_size = sizeof(oled_buf),
+        // Values as shown (0.1 C, 0.1 %RH, 1 hPa), the readouts are only
+        // redrawn when one of them changed
+        const int32_t now[3] = {
+            DIV_ROUND_CLOSEST(sample.temp_mc, 100),
+            DIV_ROUND_CLOSEST(sample.hum_mrh, 100),
+            DIV_ROUND_CLOSEST(sample.press_pa, 100),
         };
 
-        display_write(ssd1306, 0, 0, &desc, oled_buf);
+        if (!drawn || memcmp(now, shown, sizeof(now)) != 0) {
+            memcpy(shown, now, sizeof(shown));
+            drawn = true;
+            changed = true;
+
+            fb_fill_rect(0, 0, OLED_WIDTH, READOUT_H, false);
+
+            // Temperature in the medium font, humidity and pressure to its right
+            fb_number(0, 0, FB_FONT_MEDIUM, sample.temp_mc, 1, "\177C");
+            fb_number(86, 0, FB_FONT_SMALL, sample.hum_mrh, 1, "%");
+            fb_number(86, 8, FB_FONT_SMALL, sample.press_pa * 10, 0, "hPa");
+        }
 
-        k_msleep(display_sleep_ms);  // update every 0.5s
+        if (!changed || !panel)
+            continue;
+
+        // Only the columns that differ reach the panel
+        oled_flush();
     }
 }
 
@@ -121,15 +228,24 @@ int main(void)
     k_tid_t sensor_tid;
     k_tid_t display_tid;
 
-    if(!device_is_ready(bme280)){
-        printk("Device %s is not ready.\n", bme280->name);
-        return 0;
+    // Every I2C transfer from here on goes through the scheduler
+    i2c_sched_start();
+
+    // A missing device is not fatal, it is set up once the watcher sees it
+    sensor_ok = sensor_init() == 0;
+    if(!sensor_ok){
+        printk("BME280 is not ready, waiting for it.\n");
     }
+    printk("BME280: %s profile, %u us conversion every %u ms\n",
+           sensor_profile()->name, bme_measure_time_us(sensor_profile()),
+           sensor_profile()->period_ms);
 
-    if(!device_is_ready(ssd1306)){
-        printk("Device %s is not ready.\n", ssd1306->name);
-        return 0;
+    panel_ok = oled_init(ssd1306, &ssd1306_iodev) == 0;
+    if(!panel_ok){
+        printk("Device %s is not ready, waiting for it.\n", ssd1306->name);
     }
+
+    i2c_watch_start(watched, ARRAY_SIZE(watched));
     // Start the sensor thread
     sensor_tid = k_thread_create(&sensor_thread,          // Thread struct
                                 sensor_stack,            // Stack
@@ -141,6 +257,7 @@ int main(void)
                                 7,                      // Priority
                                 0,                      // Options
                                 K_NO_WAIT);             // Delay
+    k_thread_name_set(sensor_tid, "sensor");
 
     // Start the display thread
     display_tid = k_thread_create(&display_thread,          // Thread struct
@@ -153,11 +270,35 @@ int main(void)
                                 8,                      // Priority
                                 0,                      // Options
                                 K_NO_WAIT);             // Delay
+    k_thread_name_set(display_tid, "display");
 
 
         
     while (1) {
         k_msleep(sleep_time_ms);
+
+        struct i2c_sched_stats st;
+        struct i2c_watch_stats ws;
+
+        // A sensor job waits at most for the display page already on the bus
+        i2c_sched_stats_get(&st);
+        printk("I2C: sensor %u jobs, max wait %u us; display %u jobs, max wait %u us; "
+               "longest job %u us\n",
+               st.prio[I2C_PRIO_HIGH].jobs, st.prio[I2C_PRIO_HIGH].max_wait_us,
+               st.prio[I2C_PRIO_LOW].jobs, st.prio[I2C_PRIO_LOW].max_wait_us,
+               st.max_job_us);
+
+        i2c_watch_stats_get(&ws);
+        printk("I2C watch: %u probes, %u detaches, %u attaches\n",
+               ws.probes, ws.detaches, ws.attaches);
+
+        struct oled_stats os;
+        struct history_stats hs;
+
+        oled_stats_get(&os);
+        history_stats_get(&hs);
+        printk("OLED: %u flushes, %u writes, %u bytes, %u columns, %u rescales\n",
+               os.flushes, os.writes, os.bytes, hs.columns, hs.rescales);
     }   
     return 0;
 }
@@ -0,0 +1,245 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+
+#include "oled.h"
+#include "i2c_sched.h"
+
+// Unchanged gaps shorter than this are sent anyway, one longer write is
+// cheaper than re-addressing the panel (a few command bytes per write)
+#define OLED_MERGE_GAP 6
+
+// SSD1306 I2C control bytes and commands
+#define SSD1306_CTRL_CMD 0x00
+#define SSD1306_CTRL_DATA 0x40
+#define SSD1306_SET_ADDR_MODE 0x20
+#define SSD1306_ADDR_MODE_HORIZONTAL 0x00
+#define SSD1306_SET_COLUMN_ADDR 0x21
+#define SSD1306_SET_PAGE_ADDR 0x22
+#define SSD1306_ADDR_CMD_LEN 9
+
+// Panel settings for oled_panel_init(), from the same node the driver uses
+#define OLED_NODE DT_ALIAS(my_disp)
+
+// Each run is an addressing command and a data write
+#define OLED_RUNS_PER_PAGE (I2C_JOB_MAX_MSGS / 2)
+
+// One queued bus job per page, with its own copy of the changed runs so
+// drawing can go on while it waits for the bus
+struct page_job {
+    struct i2c_job job;
+    uint8_t cmd[OLED_RUNS_PER_PAGE][SSD1306_ADDR_CMD_LEN];
+    uint8_t data[OLED_WIDTH + OLED_RUNS_PER_PAGE];
+};
+
+static struct rtio_iodev *oled_iodev;
+
+static uint8_t frame[OLED_PAGES][OLED_WIDTH];   // Being drawn
+static uint8_t shadow[OLED_PAGES][OLED_WIDTH];  // What the panel shows
+
+// Bumped whenever the panel may no longer match the shadow, from any thread.
+// The shadow is valid while shown_gen, owned by the display thread, matches.
+static atomic_t shadow_gen = ATOMIC_INIT(1);
+static atomic_val_t shown_gen;
+
+static struct page_job page_jobs[OLED_PAGES];
+
+// Bit per page, set while its job is not queued
+static K_EVENT_DEFINE(page_idle);
+
+static struct oled_stats stats;
+
+// The driver's power-up sequence, for a panel that lost power while the
+// app kept running. Control byte first, then one command stream.
+static uint8_t panel_init_cmds[] = {
+    SSD1306_CTRL_CMD,
+    0xAE,                                           // Display off
+    0xD5, 0x80,                                     // Clock divide, reset value
+    0xA8, DT_PROP(OLED_NODE, multiplex_ratio),
+    0xD3, DT_PROP(OLED_NODE, display_offset),
+    0x40,                                           // Start line 0
+    0x8D, 0x14,                                     // Charge pump on
+    DT_PROP_OR(OLED_NODE, segment_remap, 0) ? 0xA1 : 0xA0,
+    DT_PROP_OR(OLED_NODE, com_invdir, 0) ? 0xC8 : 0xC0,
+    0xDA, DT_PROP_OR(OLED_NODE, com_sequential, 0) ? 0x02 : 0x12,
+    0x81, 0x7F,                                     // Contrast, reset value
+    0xD9, DT_PROP(OLED_NODE, prechargep),
+    0xDB, 0x20,                                     // VCOMH deselect level
+    0xA4,                                           // Show RAM contents
+    DT_PROP_OR(OLED_NODE, inversion_on, 0) ? 0xA7 : 0xA6,
+    0xAF,                                           // Display on
+};
+
+static struct i2c_job panel_init_job;
+
+int oled_init(const struct device *dev, struct rtio_iodev *iodev)
+{
+    oled_iodev = iodev;
+    atomic_inc(&shadow_gen);    // Panel RAM is random after power-up
+    memset(frame, 0, sizeof(frame));
+    k_event_set(&page_idle, BIT_MASK(OLED_PAGES));
+
+    // The driver has set the panel up, from here on only oled.c writes to
+    // it. Without a panel at boot, oled_panel_init() sets it up later.
+    if (!device_is_ready(dev)) {
+        return -ENODEV;
+    }
+    return 0;
+}
+
+int oled_panel_init(void)
+{
+    panel_init_job.iodev = oled_iodev;
+    panel_init_job.prio = I2C_PRIO_LOW;
+    panel_init_job.num_msgs = 1;
+    panel_init_job.msgs[0] = (struct i2c_msg){
+        .buf = panel_init_cmds, .len = sizeof(panel_init_cmds),
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+
+    // Queued behind any page jobs, the next flush rewrites the whole panel
+    atomic_inc(&shadow_gen);
+    return i2c_sched_run(&panel_init_job);
+}
+
+uint8_t *oled_framebuffer(void)
+{
+    return &frame[0][0];
+}
+
+void oled_clear(void)
+{
+    memset(frame, 0, sizeof(frame));
+}
+
+static void page_job_done(struct i2c_job *job, int result)
+{
+    int page = (int)(uintptr_t)job->user_data;
+
+    // The shadow was updated when the job was queued, resend everything.
+    // May run before oled_flush() has finished queueing, the bump is not lost.
+    if (result != 0) {
+        atomic_inc(&shadow_gen);
+    }
+    k_event_post(&page_idle, BIT(page));
+}
+
+// Add columns [x0, x1) of the page to its job and remember them as shown
+static void page_job_add_run(struct page_job *pj, int page, int x0, int x1,
+                             uint8_t **data)
+{
+    int run = pj->job.num_msgs / 2;
+    uint8_t *cmd = pj->cmd[run];
+    uint8_t *out = *data;
+
+    cmd[0] = SSD1306_CTRL_CMD;
+    cmd[1] = SSD1306_SET_ADDR_MODE;
+    cmd[2] = SSD1306_ADDR_MODE_HORIZONTAL;
+    cmd[3] = SSD1306_SET_COLUMN_ADDR;
+    cmd[4] = x0;
+    cmd[5] = x1 - 1;
+    cmd[6] = SSD1306_SET_PAGE_ADDR;
+    cmd[7] = page;
+    cmd[8] = page;
+
+    out[0] = SSD1306_CTRL_DATA;
+    memcpy(&out[1], &frame[page][x0], x1 - x0);
+
+    pj->job.msgs[run * 2] = (struct i2c_msg){
+        .buf = cmd, .len = SSD1306_ADDR_CMD_LEN,
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+    pj->job.msgs[run * 2 + 1] = (struct i2c_msg){
+        .buf = out, .len = x1 - x0 + 1,
+        .flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+    };
+    pj->job.num_msgs += 2;
+    *data = out + x1 - x0 + 1;
+
+    memcpy(&shadow[page][x0], &frame[page][x0], x1 - x0);
+    stats.writes++;
+    stats.bytes += x1 - x0;
+}
+
+// Queue the changed runs of one page, merging runs separated by short
+// unchanged gaps, or the whole page if full. Waits only if the page's
+// previous job is still queued.
+static int oled_queue_page(int page, bool full)
+{
+    struct page_job *pj = &page_jobs[page];
+    uint8_t *data = pj->data;
+    int last;
+
+    if (!full && memcmp(frame[page], shadow[page], OLED_WIDTH) == 0) {
+        return 0;
+    }
+
+    k_event_wait(&page_idle, BIT(page), false, K_FOREVER);
+    k_event_clear(&page_idle, BIT(page));
+
+    pj->job.iodev = oled_iodev;
+    pj->job.prio = I2C_PRIO_LOW;
+    pj->job.cb = page_job_done;
+    pj->job.user_data = (void *)(uintptr_t)page;
+    pj->job.num_msgs = 0;
+
+    if (full) {
+        page_job_add_run(pj, page, 0, OLED_WIDTH, &data);
+        return i2c_sched_submit(&pj->job);
+    }
+
+    for (last = OLED_WIDTH; frame[page][last - 1] == shadow[page][last - 1]; last--) {
+    }
+
+    int x = 0;
+
+    while (x < last) {
+        while (frame[page][x] == shadow[page][x]) {
+            x++;
+        }
+
+        int start = x;
+        int end = x;
+
+        // Out of messages: the last run takes the rest of the page
+        if (pj->job.num_msgs / 2 == OLED_RUNS_PER_PAGE - 1) {
+            x = end = last;
+        }
+
+        while (x < last && x - end <= OLED_MERGE_GAP) {
+            if (frame[page][x] != shadow[page][x]) {
+                end = x + 1;
+            }
+            x++;
+        }
+        page_job_add_run(pj, page, start, end, &data);
+        x = end;
+    }
+    return i2c_sched_submit(&pj->job);
+}
+
+int oled_flush(void)
+{
+    int ret = 0;
+    atomic_val_t gen = atomic_get(&shadow_gen);
+    bool full = gen != shown_gen;
+
+    stats.flushes++;
+
+    for (int page = 0; page < OLED_PAGES && ret == 0; page++) {
+        ret = oled_queue_page(page, full);
+    }
+
+    // A job that fails from here on bumps shadow_gen past gen
+    if (ret == 0) {
+        shown_gen = gen;
+    }
+    return ret;
+}
+
+void oled_stats_get(struct oled_stats *out)
+{
+    *out = stats;
+}
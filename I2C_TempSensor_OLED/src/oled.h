@@ -0,0 +1,43 @@
+#ifndef OLED_H
+#define OLED_H
+
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/rtio/rtio.h>
+
+// SSD1306 geometry: 8 pages of 128 columns, one byte is 8 vertical pixels
+#define OLED_WIDTH 128
+#define OLED_HEIGHT 64
+#define OLED_PAGES (OLED_HEIGHT / 8)
+
+// Bus traffic counters, to check the display is quiet when nothing changes
+struct oled_stats {
+    uint32_t flushes;           // oled_flush() calls
+    uint32_t writes;            // Column runs queued
+    uint32_t bytes;             // Pixel bytes queued
+};
+
+// dev is the SSD1306 display device, which initialises the panel. Frames
+// are then written through the I2C bus scheduler on iodev, from
+// I2C_DT_IODEV_DEFINE() on the same node.
+int oled_init(const struct device *dev, struct rtio_iodev *iodev);
+
+// Run the panel's power-up sequence again and resend the whole frame with
+// the next flush, for a panel that was replugged. Waits for the bus.
+int oled_panel_init(void);
+
+// Frame being drawn, laid out like the panel RAM: page p, column x is
+// oled_framebuffer()[p * OLED_WIDTH + x]
+uint8_t *oled_framebuffer(void);
+
+void oled_clear(void);
+
+// Send only what differs from the panel: changed column ranges of changed
+// pages, one low priority bus job per page so sensor reads can go between
+// pages. Returns once the jobs are queued. The first flush rewrites the
+// whole panel.
+int oled_flush(void);
+
+void oled_stats_get(struct oled_stats *out);
+
+#endif // OLED_H
@@ -0,0 +1,12 @@
+#include <zephyr/zbus/zbus.h>
+
+#include "sensor_bus.h"
+
+// Observers attach themselves with ZBUS_CHAN_ADD_OBS, so adding a consumer
+// never touches the sensor side
+ZBUS_CHAN_DEFINE(bme280_chan,
+                 struct bme280_sample,
+                 NULL,                  // No validator
+                 NULL,                  // No user data
+                 ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
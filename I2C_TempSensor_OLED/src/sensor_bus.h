@@ -0,0 +1,22 @@
+#ifndef SENSOR_BUS_H
+#define SENSOR_BUS_H
+
+#include <stdint.h>
+#include <zephyr/zbus/zbus.h>
+
+// One complete BME280 reading, published on bme280_chan
+struct bme280_sample {
+    int64_t timestamp_ms;       // k_uptime_get() when the sample was fetched
+    uint32_t seq;               // Increments with every sample
+    int32_t temp_mc;            // Temperature, milli degrees C
+    uint32_t press_pa;          // Pressure, Pa
+    uint32_t hum_mrh;           // Humidity, milli %RH
+};
+
+/* Latest sample from the sensor thread. Consumers either read the current
+ value with zbus_chan_read() whenever they like, or subscribe with
+ ZBUS_CHAN_ADD_OBS(bme280_chan, ...) to be woken on every new sample. The
+ sensor thread is the only publisher.*/
+ZBUS_CHAN_DECLARE(bme280_chan);
+
+#endif // SENSOR_BUS_H
@@ -7,7 +7,12 @@
 #include <zephyr/sys/time_units.h>
 
 // Custom libraries
-#include "wifi.h"
+#include "wifi_conn.h"
+#include "radar_mqtt.h"
+
+// Output mode: the radar page is served to a browser on port 80. With
+// CONFIG_RADAR_MQTT_MODE=y every sweep is published to the MQTT broker
+// instead, see the Kconfig help and overlay-tls.conf
 
 // WiFi settings
 #define WIFI_SSID ""      // Enter the wifi username
@@ -26,129 +31,119 @@ uint64_t duration_us = 0;   // Duration in micro seconds
 uint32_t pulse_ns = 0;      // Duty Cycle Pulse
 uint32_t distance_cm = 0;   // Total distance in cm
 int angle = 0;
+int64_t first_sample_ms = -1;   // Uptime of the first reading, for boot timing
 
 // Get devicetree configurations 
 static const struct pwm_dt_spec servo = PWM_DT_SPEC_GET(DT_ALIAS(motor_0));
 static const struct gpio_dt_spec trig = GPIO_DT_SPEC_GET(DT_ALIAS(hc_trig),gpios);
 static const struct gpio_dt_spec echo = GPIO_DT_SPEC_GET(DT_ALIAS(hc_echo),gpios);
 
-// Create a function for the clockwise rotation of the servo motor by passing the client socket
-int radar_clockwise(int client_sock){
+// Called for every point of a sweep with the distance in cm (-1 = no echo).
+// A negative return aborts the sweep.
+typedef int (*radar_point_cb)(int angle, int distance, void *arg);
+
+// Move the servo to the angle and take one ultrasonic reading
+static int radar_measure(int angle){
+
+    // 0.5ms pulse represents the 0 degree position
+    // 2.5ms pulse represents the 180 degree position
+    // Since the difference is 2ms, divide it by 180 to get the steps per degree
+    pulse_ns = 500000 + (angle * 2000000 / 180);
+
+    // Set the pulse in the pwm
+    pwm_set_pulse_dt(&servo, pulse_ns);
+    k_msleep(50);
+
+    // Fire the trigger pulse
+    gpio_pin_set_dt(&trig, 1);
+    k_busy_wait(10);
+    gpio_pin_set_dt(&trig, 0);
+
+    // Check for the echo pin to go high
+    counter = 0;
+    while(gpio_pin_get_dt(&echo) == 0){
+        counter++;
+        if(counter>MAX_TICKS) // Condition to break the detection
+            break;
+    }
+    start_time = k_cycle_get_32();  // Record the cycle time in ticks once the echo goes high
+
+    // Check for the echo pin to go low
+    counter2 = 0;
+    while(gpio_pin_get_dt(&echo) == 1){
+        counter2++;
+        if(counter2>MAX_TICKS)
+            break;
+    }
+    stop_time = k_cycle_get_32();   // Record the cycle time in ticks once the echo goes low
+
+    // If the counter maxed out there was no echo
+    if(counter >= MAX_TICKS || counter2 >= MAX_TICKS){
+        printk("No object detected");
+        return -1;
+    }
+
+    duration = stop_time - start_time;  // Gives the duration of the ticks from the time of pulse transmission and reception
+    duration_us = (uint64_t)duration * 1000000 / CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC;    // Converting ticks to microseconds -> ticks *1000000 / clock frequency
+    // Sound travels at 343 m/s and in microseconds 0.0343 cm/us so 34/(2*1000) where 2 is because the distance of the object is just half of the total to and fro distance travelled
+    distance_cm = (duration_us * 34) / 2000;
+    printk("Angle: %d, Distance: %u cm\n", angle, distance_cm);
 
-    for(int angle = 0; angle<=180; angle+=5)
+    if (first_sample_ms < 0) {
+        first_sample_ms = k_uptime_get();
+        printk("Boot: first sample %lld ms\n", (long long)first_sample_ms);
+    }
+    return distance_cm;
+}
+
+// Sweep the servo clockwise (0 -> 180) or anticlockwise and report every point
+int radar_sweep(bool clockwise, radar_point_cb cb, void *arg){
+
+    for(int i = 0; i < SWEEP_POINTS; i++)
         {
-            char buf[32];
-
-            // 0.5ms pulse represents the 0 degree position
-            // 2.5ms pulse represents the 180 degree position
-            // Since the difference is 2ms, divide it by 180 to get the steps per degree
-            pulse_ns = 500000 + (angle * 2000000 / 180);
-
-            // Set the pulse in the pwm
-            pwm_set_pulse_dt(&servo, pulse_ns);
-            k_msleep(50);
-
-            // Fire the trigger pulse
-            gpio_pin_set_dt(&trig, 1);
-            k_busy_wait(10);
-            gpio_pin_set_dt(&trig, 0);
-
-            // Check for the echo pin to go high
-            counter = 0;
-            while(gpio_pin_get_dt(&echo) == 0){
-                counter++;
-                if(counter>MAX_TICKS) // Condition to break the detection
-                    break;
-            }
-            start_time = k_cycle_get_32();  // Record the cycle time in ticks once the echo goes high
-
-            // Check for the echo pin to go low
-            counter2 = 0;
-            while(gpio_pin_get_dt(&echo) == 1){
-                counter2++;
-                if(counter2>MAX_TICKS)
-                    break;
-            }
-            stop_time = k_cycle_get_32();   // Record the cycle time in ticks once the echo goes low
-            
-            // If the counter does not max out calculate the distance
-            if(counter < MAX_TICKS && counter2 < MAX_TICKS)
-            {
-                duration = stop_time - start_time;  // Gives the duration of the ticks from the time of pulse transmission and reception
-                duration_us = (uint64_t)duration * 1000000 / CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC;    // Converting ticks to microseconds -> ticks *1000000 / clock frequency
-                // Sound travels at 343 m/s and in microseconds 0.0343 cm/us so 34/(2*1000) where 2 is because the distance of the object is just half of the total to and fro distance travelled
-                distance_cm = (duration_us * 34) / 2000;
-                printk("Angle: %d, Distance: %u cm\n", angle, distance_cm);
-                snprintf(buf, sizeof(buf), "<script>d(%d,%u);</script>\n", angle, distance_cm); // Add the sensor readings to the buffer
-                int ret = zsock_send(client_sock, buf, strlen(buf), 0); // Send it to the client socket
-                if (ret < 0) {
-                    printk("Client disconnected during sweep.\n");
-                    return -1; // Critical: breaks the infinite loop in main
-                }
+            int angle = clockwise ? i * SWEEP_STEP : 180 - i * SWEEP_STEP;
+
+            if (cb(angle, radar_measure(angle), arg) < 0) {
+                return -1;
             }
-            else
-                printk("No object detected");
         }
         k_msleep(wait_time_ms);
-        return 0; 
+        return 0;
 }
 
-// Create a function for the clockwise rotation of the servo motor by passing the client socket
-int radar_aclockwise(int client_sock){
-
-    for(int angle = 180; angle>=0; angle-=5)
+#if defined(CONFIG_RADAR_MQTT_MODE)
+// Store each point in the frame being built
+static int frame_point(int angle, int distance, void *arg){
+    struct radar_frame *frame = arg;
 
-        {
-            char buf[32];
-            pulse_ns = 500000 + (angle * 2000000 / 180);
-
-            pwm_set_pulse_dt(&servo, pulse_ns);
-            k_msleep(50);
-            
-            gpio_pin_set_dt(&trig, 1);
-            k_busy_wait(10);
-            gpio_pin_set_dt(&trig, 0);
-
-            counter = 0;
-            while(gpio_pin_get_dt(&echo) == 0){
-                counter++;
-                if(counter>MAX_TICKS)
-                    break;
-            }
-            start_time = k_cycle_get_32();  
+    frame->dist_cm[angle / SWEEP_STEP] = distance < 0 ? 0 : MIN(distance, UINT16_MAX);
+    return 0;
+}
+#else
+// Send each detected point to the browser as a script call
+static int http_point(int angle, int distance, void *arg){
+    int client_sock = *(int *)arg;
+    char buf[32];
 
-            counter2 = 0;
-            while(gpio_pin_get_dt(&echo) == 1){
-                counter2++;
-                if(counter2>MAX_TICKS)
-                    break;
-            }
-            stop_time = k_cycle_get_32();
-            
-            if(counter < MAX_TICKS && counter2 < MAX_TICKS)
-            {
-                duration = stop_time - start_time;
-                duration_us = (uint64_t)duration * 1000000 / CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC;
-                distance_cm = (duration_us * 34) / 2000;
-                printk("Angle: %d, Distance: %u cm\n", angle, distance_cm);
-                snprintf(buf, sizeof(buf), "<script>d(%d,%u);</script>\n", angle, distance_cm);
-                int ret = zsock_send(client_sock, buf, strlen(buf), 0);
-                if (ret < 0) {
-                    printk("Client disconnected during sweep.\n");
-                    return -1; // Critical: breaks the infinite loop in main
-                }
-            }
-            else
-                printk("No object detected");
-        }         
-        k_msleep(wait_time_ms);    
+    if (distance < 0) {
         return 0;
+    }
+
+    snprintf(buf, sizeof(buf), "<script>d(%d,%u);</script>\n", angle, distance); // Add the sensor readings to the buffer
+    int ret = zsock_send(client_sock, buf, strlen(buf), 0); // Send it to the client socket
+    if (ret < 0) {
+        printk("Client disconnected during sweep.\n");
+        return -1; // Critical: breaks the infinite loop in main
+    }
+    return 0;
 }
+#endif
 
 
 
 int main(void)
 {
+#if !defined(CONFIG_RADAR_MQTT_MODE)
     struct sockaddr_in serv_addr;  // Defines the IPv4 internet address structure for the server to listen on
     
     struct sockaddr_in client_addr; // Used to store the IPv4 address information for a network connection, here the device visiting the website
@@ -156,9 +151,18 @@ int main(void)
     socklen_t client_addr_len = sizeof(client_addr);
 
     int sock;
-    int ret;
 
     char *header = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nConnection: close\r\n\r\n";
+#endif
+    int ret;
+
+    // Associate and get an address in the background, the radar starts
+    // sweeping straight away
+    ret = wifi_conn_start(WIFI_SSID, WIFI_PSK);
+    if (ret < 0) {
+        printk("Error (%d): WiFi connection failed\r\n", ret);
+        return 0;
+    }
     
     // Check if the trigger is ready
     if(!gpio_is_ready_dt(&trig))
@@ -180,20 +184,28 @@ int main(void)
     if(ret<0)
         return 0;    
 
-    // Initialize WiFi
-    wifi_init();
+#if defined(CONFIG_RADAR_MQTT_MODE)
+    static struct radar_frame frame;
+    bool clockwise = true;
 
-    // Connect to the WiFi network (blocking)
-    ret = wifi_connect(WIFI_SSID, WIFI_PSK);
-    if (ret < 0) {
-        printk("Error (%d): WiFi connection failed\r\n", ret);
-        return 0;
+    // The network thread waits for WiFi and publishes, the sweep loop only
+    // queues frames so a slow or missing network never stalls the servo
+    radar_mqtt_start();
+    gpio_pin_set_dt(&trig, 0);
+
+    while (1) {
+        frame.seq++;
+        frame.clockwise = clockwise;
+        frame.timestamp_ms = k_uptime_get();
+        radar_sweep(clockwise, frame_point, &frame);
+        radar_mqtt_submit(&frame);
+        clockwise = !clockwise;
     }
+#else
+    // The page is only served once there is a network to serve it on
+    wifi_conn_wait_ready(K_FOREVER);
+    wifi_conn_print_status();
 
-    // Wait to receive an IP address (blocking)
-    wifi_wait_for_ip_addr();
-    
-    
     // server definition
     memset(&serv_addr, 0, sizeof(serv_addr));   // Clear memory to prevent garbage values
     serv_addr.sin_family = AF_INET;              // IPv4
@@ -262,12 +274,13 @@ int main(void)
         zsock_send(client_sock, html_top, strlen(html_top), 0);
         
         while (1) {
-        if (radar_clockwise(client_sock) < 0) break;
-        if (radar_aclockwise(client_sock) < 0) break;
+        if (radar_sweep(true, http_point, &client_sock) < 0) break;
+        if (radar_sweep(false, http_point, &client_sock) < 0) break;
     }
         char *html_bottom = "</body></html>";
         zsock_send(client_sock, html_bottom, strlen(html_bottom), 0);
         zsock_close(client_sock);       // Clsoe the socket
         
     }
+#endif
 }
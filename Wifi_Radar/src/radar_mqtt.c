@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "wifi_conn.h"
+#include "mqtt_src.h"
+#include "cbor_enc.h"
+#include "radar_mqtt.h"
+
+extern struct mqtt_client client_ctx;
+extern bool mqtt_connected;
+
+#define FRAME_TOPIC "esp32/radar/sweep"
+#define EVENT_TOPIC "esp32/radar/event"
+
+// Frames waiting for the network, a sweep takes ~2 s so two is plenty
+#define FRAME_QUEUE_LEN 2
+
+// A point counts as changed when it moves by more than this
+#define EVENT_THRESHOLD_CM 20
+#define EVENT_MAX_POINTS 8
+#define EVENT_MIN_INTERVAL_MS 1000
+
+#define MQTT_RECONNECT_MS 5000
+
+// The TLS handshake runs on this thread too
+#if defined(CONFIG_MQTT_LIB_TLS)
+#define NET_THREAD_STACK_SIZE 8192
+#else
+#define NET_THREAD_STACK_SIZE 4096
+#endif
+#define NET_THREAD_PRIORITY 8
+
+/* CBOR message keys
+   sweep: {1: seq, 2: ts, 3: clockwise, 4: step, 5: h'<uint16 LE cm per angle>'}
+   event: {1: seq, 2: ts, 6: [[angle, old_cm, new_cm], ...], 7: [angle, cm]}*/
+#define KEY_SEQ 1
+#define KEY_TS 2
+#define KEY_DIR 3
+#define KEY_STEP 4
+#define KEY_DIST 5
+#define KEY_CHANGES 6
+#define KEY_NEAREST 7
+
+K_MSGQ_DEFINE(frame_q, sizeof(struct radar_frame), FRAME_QUEUE_LEN, 8);
+
+K_THREAD_STACK_DEFINE(net_stack, NET_THREAD_STACK_SIZE);
+static struct k_thread net_thread;
+
+static uint8_t payload_buf[128];
+static uint32_t frames_dropped;
+
+void radar_mqtt_submit(const struct radar_frame *frame)
+{
+    struct radar_frame old;
+
+    // Make room by discarding the oldest frame, fresh data matters more
+    while (k_msgq_put(&frame_q, frame, K_NO_WAIT) != 0) {
+        if (k_msgq_get(&frame_q, &old, K_NO_WAIT) == 0) {
+            frames_dropped++;
+        }
+    }
+}
+
+static int publish_frame(const struct radar_frame *f)
+{
+    struct cbor_writer w;
+    uint8_t dist[SWEEP_POINTS * 2];
+
+    for (int i = 0; i < SWEEP_POINTS; i++) {
+        sys_put_le16(f->dist_cm[i], &dist[i * 2]);
+    }
+
+    cbor_writer_init(&w, payload_buf, sizeof(payload_buf));
+    cbor_put_map(&w, 5);
+    cbor_put_uint(&w, KEY_SEQ);
+    cbor_put_uint(&w, f->seq);
+    cbor_put_uint(&w, KEY_TS);
+    cbor_put_int(&w, f->timestamp_ms);
+    cbor_put_uint(&w, KEY_DIR);
+    cbor_put_bool(&w, f->clockwise);
+    cbor_put_uint(&w, KEY_STEP);
+    cbor_put_uint(&w, SWEEP_STEP);
+    cbor_put_uint(&w, KEY_DIST);
+    cbor_put_bstr(&w, dist, sizeof(dist));
+
+    int len = cbor_writer_finish(&w);
+    if (len < 0) {
+        return len;
+    }
+    return app_mqtt_publish_raw(&client_ctx, FRAME_TOPIC, payload_buf, len);
+}
+
+// Compare against the previous sweep and report moved or new objects
+static int publish_event(const struct radar_frame *prev,
+                         const struct radar_frame *f)
+{
+    struct cbor_writer w;
+    int changed[EVENT_MAX_POINTS];
+    int n = 0;
+    int nearest = -1;
+
+    for (int i = 0; i < SWEEP_POINTS; i++) {
+        if (f->dist_cm[i] &&
+            (nearest < 0 || f->dist_cm[i] < f->dist_cm[nearest])) {
+            nearest = i;
+        }
+        if (n < EVENT_MAX_POINTS &&
+            abs((int)f->dist_cm[i] - (int)prev->dist_cm[i]) > EVENT_THRESHOLD_CM) {
+            changed[n++] = i;
+        }
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    cbor_writer_init(&w, payload_buf, sizeof(payload_buf));
+    cbor_put_map(&w, nearest >= 0 ? 4 : 3);
+    cbor_put_uint(&w, KEY_SEQ);
+    cbor_put_uint(&w, f->seq);
+    cbor_put_uint(&w, KEY_TS);
+    cbor_put_int(&w, f->timestamp_ms);
+    cbor_put_uint(&w, KEY_CHANGES);
+    cbor_put_array(&w, n);
+    for (int i = 0; i < n; i++) {
+        cbor_put_array(&w, 3);
+        cbor_put_uint(&w, changed[i] * SWEEP_STEP);
+        cbor_put_uint(&w, prev->dist_cm[changed[i]]);
+        cbor_put_uint(&w, f->dist_cm[changed[i]]);
+    }
+    if (nearest >= 0) {
+        cbor_put_uint(&w, KEY_NEAREST);
+        cbor_put_array(&w, 2);
+        cbor_put_uint(&w, nearest * SWEEP_STEP);
+        cbor_put_uint(&w, f->dist_cm[nearest]);
+    }
+
+    int len = cbor_writer_finish(&w);
+    if (len < 0) {
+        return len;
+    }
+    return app_mqtt_publish_raw(&client_ctx, EVENT_TOPIC, payload_buf, len);
+}
+
+// Network thread start function, the only user of the MQTT client
+static void net_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    static struct radar_frame frame;
+    static struct radar_frame prev;
+    bool have_prev = false;
+    int64_t last_event = 0;
+    int64_t last_reconnect = 0;
+    uint32_t reported_drops = 0;
+    bool first_publish = true;
+
+    // Sweeps taken meanwhile wait in the frame queue, newest kept
+    wifi_conn_wait_ready(K_FOREVER);
+    wifi_conn_print_status();
+
+    mqtt_init();
+    app_mqtt_connect(&client_ctx);
+    last_reconnect = k_uptime_get();
+
+    while (1) {
+        if (!mqtt_connected &&
+            k_uptime_get() - last_reconnect > MQTT_RECONNECT_MS) {
+            last_reconnect = k_uptime_get();
+            app_mqtt_connect(&client_ctx);
+        }
+
+        // Wake up for new frames, or at least every 100 ms for keepalive
+        if (k_msgq_get(&frame_q, &frame, K_MSEC(100)) == 0 && mqtt_connected) {
+            if (publish_frame(&frame) >= 0 && first_publish) {
+                struct wifi_conn_stats ws;
+
+                first_publish = false;
+                wifi_conn_stats_get(&ws);
+                printk("Boot: network ready %lld ms, first publish %lld ms\n",
+                       (long long)(ws.start_ms + ws.first_ready_ms),
+                       (long long)k_uptime_get());
+            }
+
+            if (have_prev &&
+                k_uptime_get() - last_event >= EVENT_MIN_INTERVAL_MS &&
+                publish_event(&prev, &frame) > 0) {
+                last_event = k_uptime_get();
+            }
+            prev = frame;
+            have_prev = true;
+        }
+
+        if (frames_dropped != reported_drops) {
+            reported_drops = frames_dropped;
+            printk("Radar: %u frames dropped (network slow)\n", reported_drops);
+        }
+
+        mqtt_input(&client_ctx);
+        mqtt_live(&client_ctx);
+    }
+}
+
+int radar_mqtt_start(void)
+{
+    k_thread_create(&net_thread,
+                    net_stack,
+                    K_THREAD_STACK_SIZEOF(net_stack),
+                    net_thread_start,
+                    NULL, NULL, NULL,
+                    NET_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&net_thread, "radar_net");
+
+    return 0;
+}
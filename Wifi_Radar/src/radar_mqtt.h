@@ -0,0 +1,27 @@
+#ifndef RADAR_MQTT_H
+#define RADAR_MQTT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sweep geometry shared with main.c
+#define SWEEP_STEP 5
+#define SWEEP_POINTS (180 / SWEEP_STEP + 1)
+
+// One complete sweep, distances indexed by angle / SWEEP_STEP
+struct radar_frame {
+    uint32_t seq;
+    int64_t timestamp_ms;
+    bool clockwise;
+    uint16_t dist_cm[SWEEP_POINTS];     // 0 = no echo
+};
+
+// Start the network thread that owns the MQTT client. Can be called before
+// WiFi is up, the thread waits for it.
+int radar_mqtt_start(void);
+
+// Hand a finished sweep to the network thread. Never blocks: if the network
+// is behind, the oldest queued frame is dropped.
+void radar_mqtt_submit(const struct radar_frame *frame);
+
+#endif // RADAR_MQTT_H
@@ -0,0 +1,53 @@
+#ifndef WIFI_CONN_H_
+#define WIFI_CONN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+// Connection state changes reported to the registered callbacks
+enum wifi_conn_event {
+    WIFI_CONN_EVT_ASSOCIATED,   // Joined the access point, no address yet
+    WIFI_CONN_EVT_READY,        // IPv4 address assigned, sockets can be used
+    WIFI_CONN_EVT_LOST,         // Link dropped, a reconnect is scheduled
+    WIFI_CONN_EVT_FAILED,       // Association attempt failed, a retry is scheduled
+};
+
+// Runs in the network management or system work queue thread, must not block
+typedef void (*wifi_conn_cb_t)(enum wifi_conn_event evt, void *user_data);
+
+// Connection timing, all durations in ms
+struct wifi_conn_stats {
+    int64_t start_ms;           // k_uptime_get() when wifi_conn_start() was called
+    uint32_t assoc_ms;          // Last connect request to association
+    uint32_t dhcp_ms;           // Last association to IPv4 address
+    uint32_t first_ready_ms;    // wifi_conn_start() to the first address, 0 until then
+    uint32_t attempts;          // Connect requests sent
+    uint32_t failures;          // Attempts that did not associate
+    uint32_t drops;             // Established links that were lost
+};
+
+// Register a callback for connection events
+int wifi_conn_add_callback(wifi_conn_cb_t cb, void *user_data);
+
+// Start connecting in the background and return immediately. The link is
+// kept up until wifi_conn_stop(), with exponential backoff between retries.
+int wifi_conn_start(const char *ssid, const char *psk);
+
+// Stop reconnecting and disconnect
+int wifi_conn_stop(void);
+
+// Block until an IPv4 address is assigned. Returns 0 or -EAGAIN on timeout.
+int wifi_conn_wait_ready(k_timeout_t timeout);
+
+bool wifi_conn_is_ready(void);
+
+// Enable or disable WiFi power save (station sleeps between beacons)
+int wifi_conn_set_power_save(bool enable);
+
+void wifi_conn_stats_get(struct wifi_conn_stats *out);
+
+// Print SSID, channel, security, address and gateway of the current link
+void wifi_conn_print_status(void);
+
+#endif // WIFI_CONN_H_
@@ -0,0 +1,311 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/net/wifi_mgmt.h>
+
+#include "wifi_conn.h"
+
+LOG_MODULE_REGISTER(wifi_conn, CONFIG_WIFI_CONN_LOG_LEVEL);
+
+// Bits in conn_events
+#define EVT_READY BIT(0)
+
+// Event callbacks
+static struct net_mgmt_event_callback wifi_cb;
+static struct net_mgmt_event_callback ipv4_cb;
+
+// Set while an address is assigned, waiters block on it instead of a semaphore
+// so any number of threads can wait and none of them consume the state
+static K_EVENT_DEFINE(conn_events);
+
+// Copies of the credentials, the request is resent on every retry
+static char ssid_buf[WIFI_SSID_MAX_LEN + 1];
+static char psk_buf[WIFI_PSK_MAX_LEN + 1];
+static struct wifi_connect_req_params params;
+
+static bool enabled;
+static bool associated;
+static uint32_t retry_ms;
+static int64_t request_ms;
+static int64_t assoc_at_ms;
+
+static struct k_spinlock stats_lock;
+static struct wifi_conn_stats stats;
+
+// Registered event callbacks
+static struct {
+    wifi_conn_cb_t cb;
+    void *user_data;
+} callbacks[CONFIG_WIFI_CONN_MAX_CALLBACKS];
+static int num_callbacks;
+
+static void connect_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(connect_work, connect_work_handler);
+
+static void notify(enum wifi_conn_event evt)
+{
+    for (int i = 0; i < num_callbacks; i++) {
+        callbacks[i].cb(evt, callbacks[i].user_data);
+    }
+}
+
+// Retry later, doubling the delay every time up to the maximum
+static void schedule_retry(void)
+{
+    if (!enabled) {
+        return;
+    }
+
+    LOG_INF("Reconnecting in %u ms", retry_ms);
+    k_work_reschedule(&connect_work, K_MSEC(retry_ms));
+    retry_ms = MIN(retry_ms * 2, CONFIG_WIFI_CONN_RETRY_MAX_MS);
+}
+
+static void connect_failed(void)
+{
+    K_SPINLOCK(&stats_lock) {
+        stats.failures++;
+    }
+    notify(WIFI_CONN_EVT_FAILED);
+    schedule_retry();
+}
+
+// Send the connect request from the system work queue so wifi_conn_start()
+// and the event handlers never wait on the driver
+static void connect_work_handler(struct k_work *work)
+{
+    int ret;
+
+    if (!enabled) {
+        return;
+    }
+
+    request_ms = k_uptime_get();
+    K_SPINLOCK(&stats_lock) {
+        stats.attempts++;
+    }
+
+    ret = net_mgmt(NET_REQUEST_WIFI_CONNECT, net_if_get_default(),
+                   &params, sizeof(params));
+    if (ret < 0 && ret != -EALREADY) {
+        LOG_WRN("Connect request failed (%d)", ret);
+        connect_failed();
+    }
+}
+
+// Called when the WiFi is connected or disconnected
+static void on_wifi_connection_event(struct net_mgmt_event_callback *cb,
+                                     uint32_t mgmt_event,
+                                     struct net_if *iface)
+{
+    const struct wifi_status *status = (const struct wifi_status *)cb->info;
+
+    if (mgmt_event == NET_EVENT_WIFI_CONNECT_RESULT) {
+        if (status->status) {
+            LOG_WRN("Association failed (%d)", status->status);
+            connect_failed();
+            return;
+        }
+
+        assoc_at_ms = k_uptime_get();
+        associated = true;
+        retry_ms = CONFIG_WIFI_CONN_RETRY_MIN_MS;
+        K_SPINLOCK(&stats_lock) {
+            stats.assoc_ms = (uint32_t)(assoc_at_ms - request_ms);
+        }
+        LOG_INF("Associated in %u ms", (uint32_t)(assoc_at_ms - request_ms));
+        notify(WIFI_CONN_EVT_ASSOCIATED);
+    } else if (mgmt_event == NET_EVENT_WIFI_DISCONNECT_RESULT) {
+        k_event_clear(&conn_events, EVT_READY);
+
+        // A failed attempt also reports a disconnect, it is already retried
+        if (!associated) {
+            return;
+        }
+        associated = false;
+
+        if (enabled) {
+            LOG_WRN("Link lost");
+            K_SPINLOCK(&stats_lock) {
+                stats.drops++;
+            }
+            notify(WIFI_CONN_EVT_LOST);
+            schedule_retry();
+        } else {
+            LOG_INF("Disconnected");
+        }
+    }
+}
+
+// Called when DHCP assigns an address
+static void on_ipv4_obtained(struct net_mgmt_event_callback *cb,
+                             uint32_t mgmt_event,
+                             struct net_if *iface)
+{
+    int64_t now = k_uptime_get();
+
+    if (mgmt_event != NET_EVENT_IPV4_ADDR_ADD) {
+        return;
+    }
+
+    K_SPINLOCK(&stats_lock) {
+        stats.dhcp_ms = (uint32_t)(now - assoc_at_ms);
+        if (stats.first_ready_ms == 0) {
+            stats.first_ready_ms = (uint32_t)(now - stats.start_ms);
+        }
+    }
+    LOG_INF("Address assigned %u ms after association",
+            (uint32_t)(now - assoc_at_ms));
+
+    k_event_post(&conn_events, EVT_READY);
+    notify(WIFI_CONN_EVT_READY);
+}
+
+int wifi_conn_add_callback(wifi_conn_cb_t cb, void *user_data)
+{
+    if (num_callbacks == ARRAY_SIZE(callbacks)) {
+        return -ENOMEM;
+    }
+
+    callbacks[num_callbacks].cb = cb;
+    callbacks[num_callbacks].user_data = user_data;
+    num_callbacks++;
+    return 0;
+}
+
+int wifi_conn_start(const char *ssid, const char *psk)
+{
+    size_t ssid_len = strlen(ssid);
+    size_t psk_len = strlen(psk);
+
+    if (ssid_len == 0 || ssid_len > WIFI_SSID_MAX_LEN ||
+        psk_len > WIFI_PSK_MAX_LEN) {
+        return -EINVAL;
+    }
+
+    memcpy(ssid_buf, ssid, ssid_len + 1);
+    memcpy(psk_buf, psk, psk_len + 1);
+
+    // Fill in the connection request parameters
+    memset(&params, 0, sizeof(params));
+    params.ssid = (const uint8_t *)ssid_buf;
+    params.ssid_length = ssid_len;
+    params.psk = (const uint8_t *)psk_buf;
+    params.psk_length = psk_len;
+    params.security = psk_len ? WIFI_SECURITY_TYPE_PSK : WIFI_SECURITY_TYPE_NONE;
+    params.band = WIFI_FREQ_BAND_UNKNOWN;
+    params.channel = WIFI_CHANNEL_ANY;
+    params.mfp = WIFI_MFP_OPTIONAL;
+
+    K_SPINLOCK(&stats_lock) {
+        memset(&stats, 0, sizeof(stats));
+        stats.start_ms = k_uptime_get();
+    }
+
+    retry_ms = CONFIG_WIFI_CONN_RETRY_MIN_MS;
+    enabled = true;
+    k_work_reschedule(&connect_work, K_NO_WAIT);
+    return 0;
+}
+
+int wifi_conn_stop(void)
+{
+    enabled = false;
+    k_work_cancel_delayable(&connect_work);
+
+    return net_mgmt(NET_REQUEST_WIFI_DISCONNECT, net_if_get_default(), NULL, 0);
+}
+
+int wifi_conn_wait_ready(k_timeout_t timeout)
+{
+    return k_event_wait(&conn_events, EVT_READY, false, timeout) ? 0 : -EAGAIN;
+}
+
+bool wifi_conn_is_ready(void)
+{
+    return wifi_conn_wait_ready(K_NO_WAIT) == 0;
+}
+
+int wifi_conn_set_power_save(bool enable)
+{
+    struct net_if *iface = net_if_get_default();
+    struct wifi_ps_params ps = {
+        .enabled = enable ? WIFI_PS_ENABLED : WIFI_PS_DISABLED,
+        .type = WIFI_PS_PARAM_STATE,
+    };
+
+    return net_mgmt(NET_REQUEST_WIFI_PS, iface, &ps, sizeof(ps));
+}
+
+void wifi_conn_stats_get(struct wifi_conn_stats *out)
+{
+    K_SPINLOCK(&stats_lock) {
+        *out = stats;
+    }
+}
+
+void wifi_conn_print_status(void)
+{
+    struct wifi_iface_status status = { 0 };
+    struct net_if *iface = net_if_get_default();
+    char ip_addr[NET_IPV4_ADDR_LEN] = { 0 };
+    char gw_addr[NET_IPV4_ADDR_LEN] = { 0 };
+
+    // Get the WiFi status
+    if (net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface,
+                 &status, sizeof(status))) {
+        printk("Error: WiFi status request failed\r\n");
+    }
+
+    // Get the IP and gateway addresses
+    if (net_addr_ntop(AF_INET,
+                      &iface->config.ip.ipv4->unicast[0].ipv4.address.in_addr,
+                      ip_addr, sizeof(ip_addr)) == NULL) {
+        printk("Error: Could not convert IP address to string\r\n");
+    }
+    if (net_addr_ntop(AF_INET, &iface->config.ip.ipv4->gw,
+                      gw_addr, sizeof(gw_addr)) == NULL) {
+        printk("Error: Could not convert gateway address to string\r\n");
+    }
+
+    // Print the WiFi status
+    printk("WiFi status:\r\n");
+    if (status.state >= WIFI_STATE_ASSOCIATED) {
+        printk("  SSID: %-32s\r\n", status.ssid);
+        printk("  Band: %s\r\n", wifi_band_txt(status.band));
+        printk("  Channel: %d\r\n", status.channel);
+        printk("  Security: %s\r\n", wifi_security_txt(status.security));
+        printk("  IP address: %s\r\n", ip_addr);
+        printk("  Gateway: %s\r\n", gw_addr);
+    }
+
+    struct wifi_conn_stats st;
+
+    wifi_conn_stats_get(&st);
+    printk("  Association: %u ms, DHCP: %u ms, first ready: %u ms\r\n",
+           st.assoc_ms, st.dhcp_ms, st.first_ready_ms);
+    printk("  Attempts: %u, failures: %u, drops: %u\r\n",
+           st.attempts, st.failures, st.drops);
+}
+
+// Register the event callbacks before main() so no event can be missed
+static int wifi_conn_init(void)
+{
+    net_mgmt_init_event_callback(&wifi_cb,
+                                 on_wifi_connection_event,
+                                 NET_EVENT_WIFI_CONNECT_RESULT |
+                                 NET_EVENT_WIFI_DISCONNECT_RESULT);
+    net_mgmt_init_event_callback(&ipv4_cb,
+                                 on_ipv4_obtained,
+                                 NET_EVENT_IPV4_ADDR_ADD);
+
+    net_mgmt_add_event_callback(&wifi_cb);
+    net_mgmt_add_event_callback(&ipv4_cb);
+    return 0;
+}
+
+SYS_INIT(wifi_conn_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,52 @@
+#ifndef I2C_PROBE_H
+#define I2C_PROBE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/i2c.h>
+
+// 7-bit addresses outside this range are reserved by the I2C specification
+#define I2C_PROBE_FIRST 0x08
+#define I2C_PROBE_LAST 0x77
+
+// How an address is tested for an ACK, following i2cdetect's defaults
+enum i2c_probe_type {
+    I2C_PROBE_QUICK_WRITE,      // Zero-length write, nothing reaches the device
+    I2C_PROBE_READ_BYTE,        // One byte read, for ranges where a write could
+                                // change device state (EEPROMs, 0x30-0x37)
+};
+
+enum i2c_probe_type i2c_probe_type_for(uint16_t addr);
+
+// Fill msg with the probe for addr, for callers that queue their own
+// transfers. buf must stay valid until the transfer is done.
+void i2c_probe_msg(uint16_t addr, struct i2c_msg *msg, uint8_t *buf);
+
+// Returns true if a device acknowledges addr
+bool i2c_probe(const struct device *bus, uint16_t addr);
+
+// Device fingerprints, with CONFIG_I2C_PROBE_FINGERPRINT
+
+// ID register read used to tell devices apart
+#define I2C_FP_ADDR_ONLY -1     // No access, the address range is the only hint
+#define I2C_FP_STATUS_READ -2   // Plain one byte read without a register
+
+struct i2c_fingerprint {
+    const char *name;           // Devicetree node name
+    const char *compatible;     // NULL when Zephyr has no driver for it
+    const char *note;           // Shown in the overlay, may be NULL
+    uint8_t addr_min;
+    uint8_t addr_max;
+    int16_t reg;                // Register to read, or I2C_FP_*
+    uint8_t len;                // 1 or 2 bytes, 2 is big endian
+    uint16_t mask;
+    uint16_t value;             // Match when (read & mask) == value
+};
+
+// Identify the device at addr from the built-in table. Returns NULL if no
+// entry matches. *raw gets the value read for the matching entry.
+const struct i2c_fingerprint *i2c_fingerprint(const struct device *bus,
+                                              uint16_t addr, uint16_t *raw);
+
+#endif // I2C_PROBE_H
@@ -0,0 +1,96 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "i2c_probe.h"
+
+// Known devices, the first entry whose address range and ID register match
+// wins, so entries sharing an address go most specific first
+static const struct i2c_fingerprint table[] = {
+    { "bme280", "bosch,bme280", NULL, 0x76, 0x77, 0xD0, 1, 0xFF, 0x60 },
+    { "bmp280", "bosch,bme280", "BMP280, no humidity", 0x76, 0x77, 0xD0, 1, 0xFF, 0x58 },
+    { "bme680", "bosch,bme680", NULL, 0x76, 0x77, 0xD0, 1, 0xFF, 0x61 },
+    { "bmp180", NULL, "BMP180, no Zephyr driver", 0x77, 0x77, 0xD0, 1, 0xFF, 0x55 },
+    { "mpu6050", "invensense,mpu6050", NULL, 0x68, 0x69, 0x75, 1, 0x7E, 0x68 },
+    { "mpu9250", "invensense,mpu9250", NULL, 0x68, 0x69, 0x75, 1, 0xFF, 0x71 },
+    { "bmi160", "bosch,bmi160", NULL, 0x68, 0x69, 0x00, 1, 0xFF, 0xD1 },
+    { "lis3dh", "st,lis2dh", "LIS3DH", 0x18, 0x19, 0x0F, 1, 0xFF, 0x33 },
+    { "mcp9808", "microchip,mcp9808", NULL, 0x18, 0x1F, 0x06, 2, 0xFFFF, 0x0054 },
+    { "hmc5883l", "honeywell,hmc5883l", NULL, 0x1E, 0x1E, 0x0A, 1, 0xFF, 'H' },
+    // Only at 0x1D: reading its ID at 0x53 would move a 24Cxx address pointer
+    { "adxl345", "adi,adxl345", NULL, 0x1D, 0x1D, 0x00, 1, 0xFF, 0xE5 },
+    { "vl53l0x", "st,vl53l0x", NULL, 0x29, 0x29, 0xC0, 1, 0xFF, 0xEE },
+    { "apds9960", "avago,apds9960", NULL, 0x39, 0x39, 0x92, 1, 0xFF, 0xAB },
+    { "ccs811", "ams,ccs811", NULL, 0x5A, 0x5B, 0x20, 1, 0xFF, 0x81 },
+    { "ina219", "ti,ina219", "INA219, config register at its reset value",
+      0x40, 0x4F, 0x00, 2, 0xFFFF, 0x399F },
+    { "ssd1306", "solomon,ssd1306fb", "SSD1306 or compatible OLED, check the controller",
+      0x3C, 0x3D, I2C_FP_STATUS_READ, 1, 0x00, 0x00 },
+    { "eeprom", NULL, "EEPROM? atmel,at24 also needs size, pagesize, address-width and timeout",
+      0x50, 0x57, I2C_FP_ADDR_ONLY, 0, 0, 0 },
+};
+
+static int fingerprint_read(const struct device *bus, uint16_t addr,
+                            const struct i2c_fingerprint *fp, uint16_t *val)
+{
+    uint8_t buf[2];
+    uint8_t reg = fp->reg;
+    int ret;
+
+    if (fp->reg == I2C_FP_STATUS_READ) {
+        ret = i2c_read(bus, buf, fp->len, addr);
+    } else {
+        ret = i2c_write_read(bus, addr, &reg, 1, buf, fp->len);
+    }
+    if (ret) {
+        return ret;
+    }
+
+    *val = fp->len == 2 ? sys_get_be16(buf) : buf[0];
+    return 0;
+}
+
+const struct i2c_fingerprint *i2c_fingerprint(const struct device *bus,
+                                              uint16_t addr, uint16_t *raw)
+{
+    // Each ID register is read once even if several entries use it
+    struct {
+        int16_t reg;
+        uint8_t len;
+        int ret;
+        uint16_t val;
+    } cache[ARRAY_SIZE(table)];
+    int cached = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(table); i++) {
+        const struct i2c_fingerprint *fp = &table[i];
+        int c;
+
+        if (addr < fp->addr_min || addr > fp->addr_max) {
+            continue;
+        }
+        if (fp->reg == I2C_FP_ADDR_ONLY) {
+            *raw = 0;
+            return fp;
+        }
+
+        for (c = 0; c < cached; c++) {
+            if (cache[c].reg == fp->reg && cache[c].len == fp->len) {
+                break;
+            }
+        }
+        if (c == cached) {
+            cache[c].reg = fp->reg;
+            cache[c].len = fp->len;
+            cache[c].ret = fingerprint_read(bus, addr, fp, &cache[c].val);
+            cached++;
+        }
+
+        if (cache[c].ret == 0 && (cache[c].val & fp->mask) == fp->value) {
+            *raw = cache[c].val;
+            return fp;
+        }
+    }
+    return NULL;
+}
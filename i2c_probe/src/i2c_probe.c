@@ -0,0 +1,36 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+
+#include "i2c_probe.h"
+
+enum i2c_probe_type i2c_probe_type_for(uint16_t addr)
+{
+    if ((addr >= 0x30 && addr <= 0x37) || (addr >= 0x50 && addr <= 0x5F)) {
+        return I2C_PROBE_READ_BYTE;
+    }
+    return I2C_PROBE_QUICK_WRITE;
+}
+
+void i2c_probe_msg(uint16_t addr, struct i2c_msg *msg, uint8_t *buf)
+{
+    *buf = 0;
+    msg->buf = buf;
+
+    if (i2c_probe_type_for(addr) == I2C_PROBE_READ_BYTE) {
+        msg->len = 1;
+        msg->flags = I2C_MSG_READ | I2C_MSG_STOP;
+    } else {
+        // Zero-length write is enough to test ACK
+        msg->len = 0;
+        msg->flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+    }
+}
+
+bool i2c_probe(const struct device *bus, uint16_t addr)
+{
+    struct i2c_msg msg;
+    uint8_t buf;
+
+    i2c_probe_msg(addr, &msg, &buf);
+    return i2c_transfer(bus, &msg, 1, addr) == 0;
+}
@@ -0,0 +1,59 @@
+#ifndef BLE_POLICY_H
+#define BLE_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+
+/* Connection parameter and advertising policy. A connection runs at a short
+ interval while commands or pairing are going on and drops to a long
+ interval with peripheral latency once it has been quiet for
+ BLE_POLICY_IDLE_MS. Advertising is fast for BLE_POLICY_ADV_FAST_S after
+ boot or a disconnect, then slow until a client connects.*/
+
+// Command exchange and pairing: 15-30 ms, answered at every event
+#define BLE_POLICY_FAST_INT_MIN 12		// 1.25 ms units
+#define BLE_POLICY_FAST_INT_MAX 24
+#define BLE_POLICY_FAST_LATENCY 0
+#define BLE_POLICY_FAST_TIMEOUT 400		// 10 ms units
+
+// Idle: 100-120 ms, the lock may skip 9 events, so it wakes about once a
+// second while a write still gets through within one interval of it waking
+#define BLE_POLICY_IDLE_INT_MIN 80
+#define BLE_POLICY_IDLE_INT_MAX 96
+#define BLE_POLICY_IDLE_LATENCY 9
+#define BLE_POLICY_IDLE_TIMEOUT 600
+
+#define BLE_POLICY_IDLE_MS 5000
+#define BLE_POLICY_ADV_FAST_S 30
+
+struct ble_policy_stats {
+	uint32_t connections;
+	uint32_t first_write_last_ms;	// Connect to first command write
+	uint32_t first_write_avg_ms;
+	uint32_t first_write_max_ms;
+	uint32_t param_updates;		// Parameter changes the central accepted
+	uint32_t duty_ppm;		// Estimated radio duty since boot, parts per million
+};
+
+// Keep the advertising data, then start advertising. Call from bt_ready().
+int ble_policy_init(const struct bt_data *ad, size_t ad_len,
+		    const struct bt_data *sd, size_t sd_len);
+
+// Connection callbacks, forwarded by the app
+void ble_policy_connected(struct bt_conn *conn);
+void ble_policy_disconnected(struct bt_conn *conn);
+void ble_policy_recycled(void);
+void ble_policy_param_updated(struct bt_conn *conn, uint16_t interval,
+			      uint16_t latency, uint16_t timeout);
+
+// A command write arrived. Safe to call from the Bluetooth RX thread.
+void ble_policy_write(struct bt_conn *conn);
+
+// Pairing or another exchange that wants the short interval
+void ble_policy_activity(struct bt_conn *conn);
+
+void ble_policy_stats_get(struct ble_policy_stats *out);
+
+#endif // BLE_POLICY_H
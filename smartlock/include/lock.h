@@ -0,0 +1,53 @@
+#ifndef LOCK_H
+#define LOCK_H
+
+#include <stdint.h>
+#include <zephyr/drivers/pwm.h>
+#include <zephyr/toolchain.h>
+
+/* Lock control service. Commands are queued and carried out one at a time
+ by the lock thread, so the Bluetooth RX thread only parses and queues them.
+ CLOSE goes ahead of waiting OPENs and cancels them: locking is never held
+ up, and the lock always ends in the state of the last command.*/
+
+// Opcodes, also accepted as a single byte on the action characteristic
+enum lock_op {
+	LOCK_OP_OPEN = 0x01,
+	LOCK_OP_CLOSE = 0x02,
+};
+
+enum lock_state {
+	LOCK_STATE_LOCKED,
+	LOCK_STATE_UNLOCKED,
+	LOCK_STATE_MOVING,
+	LOCK_STATE_JAMMED,	// The servo could not be driven, until the next good move
+};
+
+// Status record as sent to clients, 4 bytes, little endian
+struct lock_status {
+	uint8_t state;		// enum lock_state
+	uint8_t op;		// Command being or last carried out, 0 before the first
+	uint16_t seq;		// Increments with every transition
+} __packed;
+
+// Called from the lock thread on every transition, must not block
+typedef void (*lock_status_cb_t)(const struct lock_status *status);
+
+// Start the lock thread and queue a CLOSE, so the servo is in a known
+// position from boot. cb may be NULL.
+int lock_init(const struct pwm_dt_spec *servo, lock_status_cb_t cb);
+
+// Turn a characteristic write into an opcode: one opcode byte, or the text
+// commands "OPEN" and "CLOSE". Returns -EINVAL for anything else.
+int lock_op_parse(const void *buf, uint16_t len);
+
+// Queue a command, never blocks. Returns -ENOSPC if the queue is full.
+int lock_submit(enum lock_op op);
+
+// Current state, MOVING while a command is carried out
+enum lock_state lock_state_get(void);
+const char *lock_state_str(enum lock_state state);
+
+void lock_status_get(struct lock_status *out);
+
+#endif // LOCK_H
@@ -0,0 +1,20 @@
+#ifndef LOCK_SVC_H
+#define LOCK_SVC_H
+
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/drivers/pwm.h>
+
+/* GATT lock service
+ action (...def2, write): OPEN/CLOSE text or an opcode byte, see lock.h
+ state  (...def1, read): the state as text
+ status (...def3, read, notify, indicate): struct lock_status on every change*/
+
+// Service UUID, for the advertising data
+#define LOCK_SVC_UUID_VAL \
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0x56789abcdef0)
+
+// Start the lock thread on servo, with its state changes pushed to the
+// subscribed clients. The service itself is registered statically.
+int lock_svc_init(const struct pwm_dt_spec *servo);
+
+#endif // LOCK_SVC_H
@@ -0,0 +1,312 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/sys/printk.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "ble_policy.h"
+
+// Estimated radio time per event, for the duty figure. The controller does
+// not report on-air time, so the duty follows from the event rate.
+#define ADV_EVENT_US 1500	// ADV_IND and a short listen on three channels
+#define ADV_DELAY_US 5000	// Mean of the random 0-10 ms added to every advertising event
+#define CONN_EVENT_US 500	// Empty packet exchange and window widening
+
+static const struct bt_le_adv_param adv_fast = BT_LE_ADV_PARAM_INIT(
+	BT_LE_ADV_OPT_CONN, BT_GAP_ADV_FAST_INT_MIN_1, BT_GAP_ADV_FAST_INT_MAX_1, NULL);
+static const struct bt_le_adv_param adv_slow = BT_LE_ADV_PARAM_INIT(
+	BT_LE_ADV_OPT_CONN, BT_GAP_ADV_SLOW_INT_MIN, BT_GAP_ADV_SLOW_INT_MAX, NULL);
+
+static const struct bt_le_conn_param conn_fast_param = BT_LE_CONN_PARAM_INIT(
+	BLE_POLICY_FAST_INT_MIN, BLE_POLICY_FAST_INT_MAX,
+	BLE_POLICY_FAST_LATENCY, BLE_POLICY_FAST_TIMEOUT);
+static const struct bt_le_conn_param conn_idle_param = BT_LE_CONN_PARAM_INIT(
+	BLE_POLICY_IDLE_INT_MIN, BLE_POLICY_IDLE_INT_MAX,
+	BLE_POLICY_IDLE_LATENCY, BLE_POLICY_IDLE_TIMEOUT);
+
+static const struct bt_data *adv_ad;
+static size_t adv_ad_len;
+static const struct bt_data *adv_sd;
+static size_t adv_sd_len;
+
+static struct k_spinlock lock;
+
+// Current connection, one reference held while it is up
+static struct bt_conn *conn_cur;
+static int64_t connected_ms;
+static bool first_write_seen;
+static bool conn_fast;		// Fast parameters in use or requested
+
+static struct ble_policy_stats stats;
+static uint64_t first_write_sum_ms;
+static uint32_t first_write_count;
+
+// Radio time of the finished modes, and the duty of the current one
+static uint64_t radio_us;
+static int64_t mode_since_ms;
+static uint32_t mode_duty_ppm;
+
+static void adv_fast_work_handler(struct k_work *work);
+static void adv_slow_work_handler(struct k_work *work);
+static void param_fast_work_handler(struct k_work *work);
+static void param_idle_work_handler(struct k_work *work);
+
+static K_WORK_DEFINE(adv_fast_work, adv_fast_work_handler);
+static K_WORK_DELAYABLE_DEFINE(adv_slow_work, adv_slow_work_handler);
+static K_WORK_DEFINE(param_fast_work, param_fast_work_handler);
+static K_WORK_DELAYABLE_DEFINE(param_idle_work, param_idle_work_handler);
+
+static uint32_t adv_duty_ppm(const struct bt_le_adv_param *param)
+{
+	uint32_t period_us = (param->interval_min + param->interval_max) * 625 / 2 +
+			     ADV_DELAY_US;
+
+	return (uint64_t)ADV_EVENT_US * 1000000 / period_us;
+}
+
+// The lock's radio only wakes for every (latency + 1)th event when idle
+static uint32_t conn_duty_ppm(uint16_t interval, uint16_t latency)
+{
+	uint32_t period_us = (uint32_t)interval * 1250 * (latency + 1);
+
+	return (uint64_t)CONN_EVENT_US * 1000000 / period_us;
+}
+
+// Close the running mode's share of the radio time and start a new one
+static void radio_mode_set(uint32_t duty_ppm)
+{
+	int64_t now = k_uptime_get();
+
+	K_SPINLOCK(&lock) {
+		radio_us += (uint64_t)(now - mode_since_ms) * mode_duty_ppm / 1000;
+		mode_since_ms = now;
+		mode_duty_ppm = duty_ppm;
+	}
+}
+
+// Reference to the current connection, NULL if there is none
+static struct bt_conn *conn_get(void)
+{
+	struct bt_conn *conn = NULL;
+
+	K_SPINLOCK(&lock) {
+		if (conn_cur != NULL) {
+			conn = bt_conn_ref(conn_cur);
+		}
+	}
+	return conn;
+}
+
+static int adv_start(const struct bt_le_adv_param *param)
+{
+	int err;
+
+	bt_le_adv_stop();
+	err = bt_le_adv_start(param, adv_ad, adv_ad_len, adv_sd, adv_sd_len);
+	if (err) {
+		printk("Advertising failed to start (err %d)\n", err);
+		radio_mode_set(0);
+		return err;
+	}
+	radio_mode_set(adv_duty_ppm(param));
+	return 0;
+}
+
+// Fast advertising after boot and every disconnect, for a quick reconnect
+static void adv_fast_work_handler(struct k_work *work)
+{
+	struct bt_conn *conn = conn_get();
+
+	if (conn != NULL) {
+		bt_conn_unref(conn);
+		return;
+	}
+	if (adv_start(&adv_fast) == 0) {
+		printk("Advertising fast for %d s\n", BLE_POLICY_ADV_FAST_S);
+		k_work_reschedule(&adv_slow_work, K_SECONDS(BLE_POLICY_ADV_FAST_S));
+	}
+}
+
+// Nobody connected during the fast window, back off until somebody does
+static void adv_slow_work_handler(struct k_work *work)
+{
+	struct bt_conn *conn = conn_get();
+
+	if (conn != NULL) {
+		bt_conn_unref(conn);
+		return;
+	}
+	if (adv_start(&adv_slow) == 0) {
+		printk("Advertising slowed down\n");
+	}
+}
+
+static void param_request(bool fast)
+{
+	struct bt_conn *conn = conn_get();
+	int err;
+
+	if (conn == NULL) {
+		return;
+	}
+
+	// The central decides, the result arrives in ble_policy_param_updated()
+	err = bt_conn_le_param_update(conn, fast ? &conn_fast_param : &conn_idle_param);
+	if (err) {
+		printk("Connection parameter request failed (err %d)\n", err);
+	} else {
+		conn_fast = fast;
+	}
+	bt_conn_unref(conn);
+}
+
+static void param_fast_work_handler(struct k_work *work)
+{
+	param_request(true);
+}
+
+static void param_idle_work_handler(struct k_work *work)
+{
+	param_request(false);
+}
+
+int ble_policy_init(const struct bt_data *ad, size_t ad_len,
+		    const struct bt_data *sd, size_t sd_len)
+{
+	adv_ad = ad;
+	adv_ad_len = ad_len;
+	adv_sd = sd;
+	adv_sd_len = sd_len;
+
+	return k_work_submit(&adv_fast_work) < 0 ? -EIO : 0;
+}
+
+void ble_policy_connected(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	k_work_cancel_delayable(&adv_slow_work);
+
+	K_SPINLOCK(&lock) {
+		if (conn_cur == NULL) {
+			conn_cur = bt_conn_ref(conn);
+			connected_ms = k_uptime_get();
+			first_write_seen = false;
+			conn_fast = false;
+			stats.connections++;
+		}
+	}
+
+	if (bt_conn_get_info(conn, &info) == 0) {
+		radio_mode_set(conn_duty_ppm(info.le.interval, info.le.latency));
+	}
+
+	// Pairing and the first command follow right away
+	ble_policy_activity(conn);
+}
+
+void ble_policy_disconnected(struct bt_conn *conn)
+{
+	struct bt_conn *old = NULL;
+	struct ble_policy_stats st;
+
+	K_SPINLOCK(&lock) {
+		if (conn_cur == conn) {
+			old = conn_cur;
+			conn_cur = NULL;
+		}
+	}
+	if (old == NULL) {
+		return;
+	}
+	bt_conn_unref(old);
+
+	k_work_cancel_delayable(&param_idle_work);
+	radio_mode_set(0);
+
+	ble_policy_stats_get(&st);
+	printk("BLE: first write after %u ms (avg %u, max %u), radio duty %u.%02u%%\n",
+	       st.first_write_last_ms, st.first_write_avg_ms, st.first_write_max_ms,
+	       st.duty_ppm / 10000, st.duty_ppm / 100 % 100);
+}
+
+// The connection object is free again, advertising can restart
+void ble_policy_recycled(void)
+{
+	k_work_submit(&adv_fast_work);
+}
+
+void ble_policy_param_updated(struct bt_conn *conn, uint16_t interval,
+			      uint16_t latency, uint16_t timeout)
+{
+	K_SPINLOCK(&lock) {
+		stats.param_updates++;
+	}
+	conn_fast = latency == 0 && interval <= BLE_POLICY_FAST_INT_MAX;
+	radio_mode_set(conn_duty_ppm(interval, latency));
+
+	printk("Connection interval %u.%02u ms, latency %u, timeout %u ms\n",
+	       interval * 125 / 100, interval * 125 % 100, latency, timeout * 10);
+}
+
+void ble_policy_write(struct bt_conn *conn)
+{
+	int64_t now = k_uptime_get();
+
+	K_SPINLOCK(&lock) {
+		if (conn == conn_cur && !first_write_seen) {
+			uint32_t ms = now - connected_ms;
+
+			first_write_seen = true;
+			first_write_sum_ms += ms;
+			first_write_count++;
+			stats.first_write_last_ms = ms;
+			stats.first_write_avg_ms = first_write_sum_ms / first_write_count;
+			stats.first_write_max_ms = MAX(stats.first_write_max_ms, ms);
+		}
+	}
+	ble_policy_activity(conn);
+}
+
+void ble_policy_activity(struct bt_conn *conn)
+{
+	if (!conn_fast) {
+		k_work_submit(&param_fast_work);
+	}
+	// Back to the idle parameters once it has been quiet for a while
+	k_work_reschedule(&param_idle_work, K_MSEC(BLE_POLICY_IDLE_MS));
+}
+
+void ble_policy_stats_get(struct ble_policy_stats *out)
+{
+	int64_t now = k_uptime_get();
+
+	K_SPINLOCK(&lock) {
+		uint64_t us = radio_us + (uint64_t)(now - mode_since_ms) * mode_duty_ppm / 1000;
+
+		*out = stats;
+		out->duty_ppm = now > 0 ? us * 1000 / now : 0;
+	}
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_blepolicy(const struct shell *sh, size_t argc, char **argv)
+{
+	struct ble_policy_stats st;
+
+	ble_policy_stats_get(&st);
+	shell_print(sh, "Connections: %u, parameter updates: %u",
+		    st.connections, st.param_updates);
+	shell_print(sh, "Connect to first write: last %u ms, avg %u ms, max %u ms",
+		    st.first_write_last_ms, st.first_write_avg_ms, st.first_write_max_ms);
+	shell_print(sh, "Estimated radio duty: %u.%02u%%",
+		    st.duty_ppm / 10000, st.duty_ppm / 100 % 100);
+	return 0;
+}
+
+SHELL_CMD_REGISTER(blepolicy, NULL, "BLE connection and advertising stats", cmd_blepolicy);
+#endif // CONFIG_SHELL
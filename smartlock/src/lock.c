@@ -0,0 +1,187 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/pwm.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+#include "lock.h"
+
+#define LOCK_THREAD_STACK_SIZE 1024
+#define LOCK_THREAD_PRIORITY 7
+
+// Commands waiting per priority
+#define LOCK_QUEUE_LEN 4
+
+// Set the lock and open pulse not to the extremes
+// Dont set it tp the extremes 0.5ms and 2.5ms
+#define LOCK_PULSE_NS 2000000
+#define OPEN_PULSE_NS 1000000
+
+// Time for the gears to move before the servo is set to rest
+#define LOCK_MOVE_MS 500
+
+K_THREAD_STACK_DEFINE(lock_stack, LOCK_THREAD_STACK_SIZE);
+static struct k_thread lock_thread;
+
+// CLOSE is queued high, OPEN low
+K_MSGQ_DEFINE(high_q, sizeof(uint8_t), LOCK_QUEUE_LEN, 1);
+K_MSGQ_DEFINE(low_q, sizeof(uint8_t), LOCK_QUEUE_LEN, 1);
+static K_SEM_DEFINE(pending, 0, K_SEM_MAX_LIMIT);
+
+static const struct pwm_dt_spec *servo;
+static lock_status_cb_t status_cb;
+
+static struct k_spinlock status_lock;
+static struct lock_status status = { .state = LOCK_STATE_LOCKED };
+
+static void set_state(enum lock_state state, uint8_t op)
+{
+	struct lock_status st;
+
+	K_SPINLOCK(&status_lock) {
+		status.state = state;
+		status.op = op;
+		status.seq = sys_cpu_to_le16(sys_le16_to_cpu(status.seq) + 1);
+		st = status;
+	}
+
+	if (status_cb != NULL) {
+		status_cb(&st);
+	}
+}
+
+// Move to the pulse, wait for the gears and let the servo rest to save energy
+static int lock_move(uint32_t pulse_ns)
+{
+	int ret = pwm_set_pulse_dt(servo, pulse_ns);
+
+	if (ret) {
+		return ret;
+	}
+	k_msleep(LOCK_MOVE_MS);
+	return pwm_set_pulse_dt(servo, 0);
+}
+
+// Lock thread start function
+static void lock_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+	uint8_t op;
+	enum lock_state done;
+	int ret;
+
+	while (1) {
+		k_sem_take(&pending, K_FOREVER);
+
+		// Cancelled OPENs leave their semaphore count behind
+		if (k_msgq_get(&high_q, &op, K_NO_WAIT) != 0 &&
+		    k_msgq_get(&low_q, &op, K_NO_WAIT) != 0) {
+			continue;
+		}
+
+		set_state(LOCK_STATE_MOVING, op);
+
+		if (op == LOCK_OP_OPEN) {
+			printk("Lock Opening\n");
+			ret = lock_move(OPEN_PULSE_NS);
+			done = LOCK_STATE_UNLOCKED;
+		} else {
+			printk("Lock Closing\n");
+			ret = lock_move(LOCK_PULSE_NS);
+			done = LOCK_STATE_LOCKED;
+		}
+
+		// Without position feedback a failed PWM write is the only jam we see
+		if (ret) {
+			printk("Lock jammed (err %d)\n", ret);
+			done = LOCK_STATE_JAMMED;
+		}
+		set_state(done, op);
+	}
+}
+
+int lock_init(const struct pwm_dt_spec *spec, lock_status_cb_t cb)
+{
+	if (!pwm_is_ready_dt(spec)) {
+		return -ENODEV;
+	}
+	servo = spec;
+	status_cb = cb;
+
+	k_thread_create(&lock_thread,
+			lock_stack,
+			K_THREAD_STACK_SIZEOF(lock_stack),
+			lock_thread_start,
+			NULL, NULL, NULL,
+			LOCK_THREAD_PRIORITY,
+			0,
+			K_NO_WAIT);
+	k_thread_name_set(&lock_thread, "lock");
+
+	return lock_submit(LOCK_OP_CLOSE);
+}
+
+int lock_op_parse(const void *buf, uint16_t len)
+{
+	const uint8_t *p = buf;
+
+	if (len == 1 && (p[0] == LOCK_OP_OPEN || p[0] == LOCK_OP_CLOSE)) {
+		return p[0];
+	}
+	// Text commands as sent by the web UI and nRF Connect
+	if (len == 4 && memcmp(p, "OPEN", 4) == 0) {
+		return LOCK_OP_OPEN;
+	}
+	if (len == 5 && memcmp(p, "CLOSE", 5) == 0) {
+		return LOCK_OP_CLOSE;
+	}
+	return -EINVAL;
+}
+
+int lock_submit(enum lock_op op)
+{
+	uint8_t msg = op;
+	int ret;
+
+	if (op == LOCK_OP_CLOSE) {
+		k_msgq_purge(&low_q);
+		ret = k_msgq_put(&high_q, &msg, K_NO_WAIT);
+	} else if (op == LOCK_OP_OPEN) {
+		ret = k_msgq_put(&low_q, &msg, K_NO_WAIT);
+	} else {
+		return -EINVAL;
+	}
+
+	if (ret) {
+		return -ENOSPC;
+	}
+	k_sem_give(&pending);
+	return 0;
+}
+
+enum lock_state lock_state_get(void)
+{
+	struct lock_status st;
+
+	lock_status_get(&st);
+	return st.state;
+}
+
+const char *lock_state_str(enum lock_state s)
+{
+	static const char *const names[] = {
+		[LOCK_STATE_LOCKED] = "LOCKED",
+		[LOCK_STATE_UNLOCKED] = "UNLOCKED",
+		[LOCK_STATE_MOVING] = "MOVING",
+		[LOCK_STATE_JAMMED] = "JAMMED",
+	};
+
+	return s < ARRAY_SIZE(names) ? names[s] : "UNKNOWN";
+}
+
+void lock_status_get(struct lock_status *out)
+{
+	K_SPINLOCK(&status_lock) {
+		*out = status;
+	}
+}
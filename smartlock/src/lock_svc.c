@@ -0,0 +1,180 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk.h>
+
+#include "lock.h"
+#include "lock_svc.h"
+#include "ble_policy.h"
+
+/////*Service and characteristics definition*/////
+
+// UUID Universally Unique Identifier 
+// Uniquely identifies information without a central registration authority
+
+// Vendor Service UUID - custom. Like a folder which has everything realted to this app
+static const struct bt_uuid_128 vnd_uuid = BT_UUID_INIT_128(
+	LOCK_SVC_UUID_VAL);
+
+// Vendor Encrypted UUID - Reading. The status characteristic
+static const struct bt_uuid_128 vnd_enc_uuid = BT_UUID_INIT_128(
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0x56789abcdef1));
+
+// Vendor Authenticated UUID - Writing. The action characteristic
+static const struct bt_uuid_128 vnd_auth_uuid = BT_UUID_INIT_128(
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0x56789abcdef2));
+
+// Lock status UUID - Notify/Indicate. Pushes every state change as a
+// struct lock_status record, so clients need not poll the string one
+static const struct bt_uuid_128 vnd_status_uuid = BT_UUID_INIT_128(
+	BT_UUID_128_ENCODE(0x12345678, 0x1234, 0x5678, 0x1234, 0x56789abcdef3));
+
+/* Callback functions
+Both run in the Bluetooth RX thread, so they only read the lock state or
+queue a command for the lock thread (lock.c) and return*/
+
+// Read callback function that reports the lock state to the client
+static ssize_t read_callback(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			void *buf, uint16_t len, uint16_t offset)
+{
+	const char *value = lock_state_str(lock_state_get());
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value,
+				 strlen(value));
+}
+
+// Write callback function validates the command and queues it. The servo
+// moves in the lock thread, a delay here would stall the connection.
+static ssize_t write_callback(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			 const void *buf, uint16_t len, uint16_t offset,
+			 uint8_t flags)
+{
+	int op;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	op = lock_op_parse(buf, len);
+	if (op < 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+	if (lock_submit(op) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+	}
+	// Keeps the short connection interval while commands come in
+	ble_policy_write(conn);
+	return len;
+}
+
+// Read callback for the status record, for a client's first look after
+// subscribing
+static ssize_t status_read_callback(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			void *buf, uint16_t len, uint16_t offset)
+{
+	struct lock_status st;
+
+	lock_status_get(&st);
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &st, sizeof(st));
+}
+
+static bool status_subscribed;
+
+// Called when a client turns notifications or indications on or off
+static void status_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	status_subscribed = value != 0;
+}
+
+// Acts as a menu for the smart lock app
+// Bundles the service and characteristics into a static array --> mostly same structure for most of the smart bluetooth applications
+// CHARACTERISTIC -> links the callback function to the private read or write data
+BT_GATT_SERVICE_DEFINE(lock_svc,	// Defines the variable name to track this service
+    BT_GATT_PRIMARY_SERVICE(&vnd_uuid), // Defines the start of the service or the folder of this entire smart lock
+    BT_GATT_CHARACTERISTIC(&vnd_auth_uuid.uuid, // Defines the function of the client, since the client writes to the server required write functions are added
+                           BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_WRITE,	// Let it remain as BT_GATT_PERM_WRITE and not BT_GATT_PERM_AUTH_WRITE 
+                           NULL, write_callback, NULL),
+	BT_GATT_CHARACTERISTIC(&vnd_enc_uuid.uuid,	// Folder for the read function of the client
+			       		   BT_GATT_CHRC_READ,	
+			       		   BT_GATT_PERM_READ,
+			               read_callback, NULL, NULL), // Callback function to read 
+	BT_GATT_CHARACTERISTIC(&vnd_status_uuid.uuid,	// Lock state pushed to the client
+			       		   BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
+			       		   BT_GATT_PERM_READ,
+			               status_read_callback, NULL, NULL),
+	BT_GATT_CCC(status_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE));
+
+/*Lock status push
+The lock thread reports each transition through lock_status_changed(). The
+record is sent from the system work queue, so the lock thread never waits
+for the Bluetooth stack. Each client gets notifications or indications,
+whichever it enabled. One indication can be in flight: if the state moved
+on meanwhile, the latest record is indicated once it is confirmed.*/
+
+static struct bt_gatt_indicate_params ind_params;
+static struct lock_status ind_status;
+static atomic_t indicating;
+
+static void status_work_handler(struct k_work *work);
+static K_WORK_DEFINE(status_work, status_work_handler);
+
+static void indicate_destroy(struct bt_gatt_indicate_params *params)
+{
+	struct lock_status st;
+
+	atomic_clear(&indicating);
+
+	lock_status_get(&st);
+	if (st.seq != ind_status.seq) {
+		k_work_submit(&status_work);
+	}
+}
+
+static void status_work_handler(struct k_work *work)
+{
+	const struct bt_gatt_attr *attr;
+	struct lock_status st;
+
+	if (!status_subscribed) {
+		return;
+	}
+
+	attr = bt_gatt_find_by_uuid(lock_svc.attrs, lock_svc.attr_count,
+				    &vnd_status_uuid.uuid);
+	lock_status_get(&st);
+
+	// Only sent to clients that enabled notifications
+	bt_gatt_notify(NULL, attr, &st, sizeof(st));
+
+	// Only sent to clients that enabled indications
+	if (!atomic_cas(&indicating, 0, 1)) {
+		return;
+	}
+	ind_status = st;
+	ind_params = (struct bt_gatt_indicate_params){
+		.attr = attr,
+		.data = &ind_status,
+		.len = sizeof(ind_status),
+		.destroy = indicate_destroy,
+	};
+	if (bt_gatt_indicate(NULL, &ind_params) != 0) {
+		atomic_clear(&indicating);
+	}
+}
+
+// Called from the lock thread
+static void lock_status_changed(const struct lock_status *status)
+{
+	printk("Lock state: %s\n", lock_state_str(status->state));
+	k_work_submit(&status_work);
+}
+
+int lock_svc_init(const struct pwm_dt_spec *servo)
+{
+	return lock_init(servo, lock_status_changed);
+}
@@ -0,0 +1,34 @@
+#ifndef SYSMON_H_
+#define SYSMON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One thread in a report
+struct sysmon_thread {
+    const char *name;           // Thread name, NULL if it has none
+    const void *thread;         // struct k_thread pointer, to tell unnamed ones apart
+    uint16_t cpu_permille;      // Share of all CPU cycles since the previous report
+    size_t stack_size;
+    size_t stack_used;          // High-water mark since the thread started
+};
+
+// System heap (CONFIG_HEAP_MEM_POOL_SIZE), all zero without one
+struct sysmon_heap {
+    size_t size;
+    size_t used;
+    size_t max_used;            // High-water mark since boot
+};
+
+// Print the compact report for the time since the previous periodic
+// report. Called every CONFIG_SYSMON_REPORT_INTERVAL_S from the system
+// work queue.
+void sysmon_print(void);
+
+// Fill out[] with up to max threads, CPU shares measured since the previous
+// sysmon_threads_get() call. Returns the number of threads filled in.
+int sysmon_threads_get(struct sysmon_thread *out, int max);
+
+void sysmon_heap_get(struct sysmon_heap *out);
+
+#endif // SYSMON_H_
@@ -0,0 +1,260 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/sys_heap.h>
+#ifdef CONFIG_SYSMON_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "sysmon.h"
+
+// Stack high-water marks above this share of the stack are flagged
+#define SYSMON_STACK_WARN_PCT 85
+
+#if defined(CONFIG_HEAP_MEM_POOL_SIZE) && CONFIG_HEAP_MEM_POOL_SIZE > 0
+extern struct k_heap _system_heap;
+#endif
+
+// CPU cycle counts at the start of a measurement window. The periodic
+// report and the API each have their own, so reading one does not shorten
+// the other.
+struct cpu_window {
+    int64_t start_ms;
+    uint64_t total;             // All cycles, idle included
+    uint64_t idle;
+    int count;
+    struct {
+        const struct k_thread *thread;
+        uint64_t cycles;
+    } prev[CONFIG_SYSMON_MAX_THREADS];
+};
+
+static struct cpu_window report_window;
+static struct cpu_window api_window;
+
+// Snapshot being built, shared under the lock to keep it off the stacks
+static K_MUTEX_DEFINE(lock);
+static struct sysmon_thread snap[CONFIG_SYSMON_MAX_THREADS];
+static uint64_t snap_cycles[CONFIG_SYSMON_MAX_THREADS];
+static int snap_count;
+
+static uint32_t interval_s = CONFIG_SYSMON_REPORT_INTERVAL_S;
+
+static void report_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(report_work, report_work_handler);
+
+// Output through printk or a shell
+typedef void (*out_fn_t)(void *ctx, const char *fmt, ...);
+
+static void out_printk(void *ctx, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vprintk(fmt, ap);
+    va_end(ap);
+}
+
+static void collect_cb(const struct k_thread *cthread, void *user_data)
+{
+    struct k_thread *thread = (struct k_thread *)cthread;
+    struct sysmon_thread *t;
+    k_thread_runtime_stats_t rt;
+    size_t unused;
+
+    if (snap_count == ARRAY_SIZE(snap)) {
+        return;
+    }
+    t = &snap[snap_count];
+
+    k_thread_runtime_stats_get(thread, &rt);
+    snap_cycles[snap_count] = rt.execution_cycles;
+
+    t->name = k_thread_name_get(thread);
+    t->thread = thread;
+    t->cpu_permille = 0;
+    t->stack_size = thread->stack_info.size;
+    t->stack_used = k_thread_stack_space_get(thread, &unused) == 0 ?
+                    t->stack_size - unused : 0;
+    snap_count++;
+}
+
+// Take a snapshot of all threads, work out the CPU shares since the
+// window started and start a new window. Called with the lock held.
+static void collect(struct cpu_window *w, uint32_t *busy_permille)
+{
+    k_thread_runtime_stats_t all;
+    uint64_t total, idle;
+
+    snap_count = 0;
+    k_thread_foreach_unlocked(collect_cb, NULL);
+    k_thread_runtime_stats_all_get(&all);
+
+    total = all.execution_cycles - w->total;
+    idle = all.idle_cycles - w->idle;
+
+    for (int i = 0; i < snap_count; i++) {
+        uint64_t prev = 0;
+
+        // A thread missing from the last window started during it
+        for (int j = 0; j < w->count; j++) {
+            if (w->prev[j].thread == snap[i].thread) {
+                prev = w->prev[j].cycles;
+                break;
+            }
+        }
+        if (total) {
+            snap[i].cpu_permille = MIN((snap_cycles[i] - prev) * 1000 / total, 1000);
+        }
+        w->prev[i].thread = snap[i].thread;
+        w->prev[i].cycles = snap_cycles[i];
+    }
+    w->count = snap_count;
+    w->total = all.execution_cycles;
+    w->idle = all.idle_cycles;
+
+    *busy_permille = total ? (uint32_t)((total - idle) * 1000 / total) : 0;
+}
+
+void sysmon_heap_get(struct sysmon_heap *out)
+{
+    memset(out, 0, sizeof(*out));
+
+#if defined(CONFIG_HEAP_MEM_POOL_SIZE) && CONFIG_HEAP_MEM_POOL_SIZE > 0
+    struct sys_memory_stats st;
+
+    if (sys_heap_runtime_stats_get(&_system_heap.heap, &st) == 0) {
+        out->size = st.free_bytes + st.allocated_bytes;
+        out->used = st.allocated_bytes;
+        out->max_used = st.max_allocated_bytes;
+    }
+#endif
+}
+
+int sysmon_threads_get(struct sysmon_thread *out, int max)
+{
+    uint32_t busy;
+    int n;
+
+    k_mutex_lock(&lock, K_FOREVER);
+    collect(&api_window, &busy);
+    api_window.start_ms = k_uptime_get();
+    n = MIN(snap_count, max);
+    memcpy(out, snap, n * sizeof(*out));
+    k_mutex_unlock(&lock);
+    return n;
+}
+
+// One header line, then one line per thread
+static void print_report(struct cpu_window *w, out_fn_t out, void *ctx)
+{
+    struct sysmon_heap heap;
+    uint32_t busy;
+    int64_t now = k_uptime_get();
+
+    sysmon_heap_get(&heap);
+
+    k_mutex_lock(&lock, K_FOREVER);
+    collect(w, &busy);
+
+    out(ctx, "sysmon %us: cpu %u.%u%% busy, heap %u/%u max %u\n",
+        (uint32_t)((now - w->start_ms) / 1000), busy / 10, busy % 10,
+        (unsigned int)heap.used, (unsigned int)heap.size,
+        (unsigned int)heap.max_used);
+
+    for (int i = 0; i < snap_count; i++) {
+        const struct sysmon_thread *t = &snap[i];
+        uint32_t pct = t->stack_size ? t->stack_used * 100 / t->stack_size : 0;
+
+        if (t->name != NULL && t->name[0] != '\0') {
+            out(ctx, "  %-16s", t->name);
+        } else {
+            out(ctx, "  %-16p", t->thread);
+        }
+        out(ctx, " %3u.%u%%  stack %5u/%-5u %3u%%%s\n",
+            t->cpu_permille / 10, t->cpu_permille % 10,
+            (unsigned int)t->stack_used, (unsigned int)t->stack_size, pct,
+            pct >= SYSMON_STACK_WARN_PCT ? " !" : "");
+    }
+    w->start_ms = now;
+    k_mutex_unlock(&lock);
+}
+
+void sysmon_print(void)
+{
+    print_report(&report_window, out_printk, NULL);
+}
+
+static void report_work_handler(struct k_work *work)
+{
+    sysmon_print();
+    if (interval_s) {
+        k_work_reschedule(&report_work, K_SECONDS(interval_s));
+    }
+}
+
+#ifdef CONFIG_SYSMON_SHELL
+static void out_shell(void *ctx, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    shell_vfprintf(ctx, SHELL_NORMAL, fmt, ap);
+    va_end(ap);
+}
+
+// CPU shares since the previous "sysmon show"
+static int cmd_show(const struct shell *sh, size_t argc, char **argv)
+{
+    print_report(&api_window, out_shell, (void *)sh);
+    return 0;
+}
+
+static int cmd_interval(const struct shell *sh, size_t argc, char **argv)
+{
+    if (argc < 2) {
+        shell_print(sh, "Report every %u s", interval_s);
+        return 0;
+    }
+
+    interval_s = strtoul(argv[1], NULL, 10);
+    if (interval_s) {
+        k_work_reschedule(&report_work, K_SECONDS(interval_s));
+        shell_print(sh, "Report every %u s", interval_s);
+    } else {
+        k_work_cancel_delayable(&report_work);
+        shell_print(sh, "Report off");
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sysmon,
+    SHELL_CMD(show, NULL, "Thread CPU and stack use, heap use", cmd_show),
+    SHELL_CMD_ARG(interval, NULL, "Periodic report interval in s, 0 = off",
+                  cmd_interval, 1, 1),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sysmon, &sub_sysmon, "Thread and memory usage", cmd_show);
+#endif // CONFIG_SYSMON_SHELL
+
+// Start both CPU windows at boot and schedule the periodic report
+static int sysmon_init(void)
+{
+    uint32_t busy;
+
+    k_mutex_lock(&lock, K_FOREVER);
+    collect(&report_window, &busy);
+    collect(&api_window, &busy);
+    k_mutex_unlock(&lock);
+
+    if (interval_s) {
+        k_work_reschedule(&report_work, K_SECONDS(interval_s));
+    }
+    return 0;
+}
+
+SYS_INIT(sysmon_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
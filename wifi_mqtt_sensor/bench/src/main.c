@@ -0,0 +1,281 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/logging/log.h>
+
+#include "mqtt_src.h"
+#include "telemetry.h"
+
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+#include <native_rtc.h>
+#endif
+
+LOG_MODULE_REGISTER(bench, LOG_LEVEL_INF);
+
+extern struct mqtt_client client_ctx;
+extern bool mqtt_connected;
+
+// Benchmark settings
+#define BENCH_TOPIC        "bench/mqtt_src"
+#define BENCH_SAMPLES      256     // Samples sent per mode
+#define BENCH_BATCH        8       // Samples per message in batched modes
+#define BENCH_DRAIN_MS     2000    // Max wait for outstanding deliveries/acks
+#define BENCH_RECONNECTS   5
+
+// One benchmark configuration
+struct bench_mode {
+    const char *name;
+    uint8_t qos;
+    bool cbor;
+    uint8_t batch;
+};
+
+static const struct bench_mode modes[] = {
+    { "q0 json single", 0, false, 1 },
+    { "q0 json batch",  0, false, BENCH_BATCH },
+    { "q0 cbor single", 0, true,  1 },
+    { "q0 cbor batch",  0, true,  BENCH_BATCH },
+    { "q1 json single", 1, false, 1 },
+    { "q1 json batch",  1, false, BENCH_BATCH },
+    { "q1 cbor single", 1, true,  1 },
+    { "q1 cbor batch",  1, true,  BENCH_BATCH },
+};
+
+static uint8_t payload_buf[512];
+static struct telemetry_record records[BENCH_BATCH];
+
+// Send time of every message, matched to deliveries by arrival order
+static uint64_t sent_us[BENCH_SAMPLES];
+static uint32_t latency_us[BENCH_SAMPLES];
+static volatile uint32_t rx_count;
+static uint32_t tx_count;
+
+// Host wall clock on native_sim. The simulated clocks, RTC_CLOCK_REALTIME
+// included, do not advance while code runs so they cannot time socket I/O
+static uint64_t bench_now_us(void)
+{
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+    return native_rtc_gettime_us(RTC_CLOCK_PSEUDOHOSTREALTIME);
+#else
+    return k_cyc_to_us_floor64(k_cycle_get_64());
+#endif
+}
+
+static void bench_rx(const char *topic, size_t topic_len,
+                     const uint8_t *payload, size_t len)
+{
+    if (rx_count < tx_count) {
+        latency_us[rx_count] = (uint32_t)(bench_now_us() - sent_us[rx_count]);
+        rx_count++;
+    }
+}
+
+// Run the MQTT state machine, waiting up to timeout_ms for socket data
+static void bench_pump(int timeout_ms)
+{
+    struct zsock_pollfd fds = {
+        .fd = client_ctx.transport.tcp.sock,
+        .events = ZSOCK_POLLIN,
+    };
+
+    if (zsock_poll(&fds, 1, timeout_ms) > 0) {
+        mqtt_input(&client_ctx);
+    }
+    mqtt_live(&client_ctx);
+}
+
+static int encode_json(const struct telemetry_record *recs, size_t count)
+{
+    size_t len = 0;
+    int n;
+
+    if (count == 1) {
+        return snprintf((char *)payload_buf, sizeof(payload_buf),
+                        "{\"temperature\": %d, \"humidity\": %d, \"ts\": %lld}",
+                        recs[0].temperature, recs[0].humidity,
+                        (long long)recs[0].timestamp_ms);
+    }
+
+    // Stop at the first truncation, len never passes the buffer end
+    payload_buf[len++] = '[';
+    for (size_t i = 0; i < count; i++) {
+        n = snprintf((char *)&payload_buf[len], sizeof(payload_buf) - len,
+                     "%s{\"temperature\": %d, \"humidity\": %d, \"ts\": %lld}",
+                     i ? "," : "", recs[i].temperature, recs[i].humidity,
+                     (long long)recs[i].timestamp_ms);
+        if (n < 0 || (size_t)n >= sizeof(payload_buf) - len) {
+            return -ENOMEM;
+        }
+        len += n;
+    }
+    n = snprintf((char *)&payload_buf[len], sizeof(payload_buf) - len, "]");
+    if (n < 0 || (size_t)n >= sizeof(payload_buf) - len) {
+        return -ENOMEM;
+    }
+
+    return len + n;
+}
+
+static int encode_cbor(const struct telemetry_record *recs, size_t count)
+{
+    if (count == 1) {
+        struct sensor_snapshot snap = {
+            .temperature = recs[0].temperature,
+            .humidity = recs[0].humidity,
+            .timestamp_ms = recs[0].timestamp_ms,
+            .quality = SAMPLE_QUALITY_GOOD,
+        };
+        return telemetry_encode_sample(payload_buf, sizeof(payload_buf), &snap);
+    }
+
+    return telemetry_encode_batch(payload_buf, sizeof(payload_buf), recs, count);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct)
+{
+    if (n == 0) {
+        return 0;
+    }
+    return sorted[MIN(n - 1, (n * pct) / 100)];
+}
+
+static void run_mode(const struct bench_mode *mode)
+{
+    const struct app_mqtt_meta meta = { .qos = mode->qos };
+    uint32_t msgs = BENCH_SAMPLES / mode->batch;
+    struct app_mqtt_stats st;
+    uint64_t start, pub_done, end;
+    int len;
+
+    app_mqtt_stats_reset();
+    rx_count = 0;
+    tx_count = 0;
+
+    start = bench_now_us();
+
+    for (uint32_t m = 0; m < msgs; m++) {
+        // Synthetic slowly varying readings, like a DHT11
+        for (uint8_t i = 0; i < mode->batch; i++) {
+            uint32_t n = m * mode->batch + i;
+
+            records[i].temperature = 20 + (n / 16) % 5;
+            records[i].humidity = 40 + (n / 8) % 7;
+            records[i].timestamp_ms = k_uptime_get() + i * 1000;
+        }
+
+        len = mode->cbor ? encode_cbor(records, mode->batch)
+                         : encode_json(records, mode->batch);
+        if (len <= 0) {
+            printk("%s: encode failed (%d)\n", mode->name, len);
+            return;
+        }
+
+        sent_us[tx_count++] = bench_now_us();
+        if (app_mqtt_publish_ex(&client_ctx, BENCH_TOPIC, payload_buf, len,
+                                &meta) < 0) {
+            printk("%s: publish failed\n", mode->name);
+            return;
+        }
+
+        // Drain whatever is already there without waiting
+        bench_pump(0);
+    }
+    pub_done = bench_now_us();
+
+    // Wait for our own messages to come back (and the PUBACKs for QoS 1)
+    do {
+        app_mqtt_stats_get(&st);
+        if (rx_count >= msgs && (mode->qos == 0 || st.pubacks >= msgs)) {
+            break;
+        }
+        bench_pump(1);
+    } while (bench_now_us() - pub_done < BENCH_DRAIN_MS * 1000ULL);
+    end = bench_now_us();
+
+    app_mqtt_stats_get(&st);
+    qsort(latency_us, rx_count, sizeof(latency_us[0]), cmp_u32);
+
+    uint64_t total_us = MAX(end - start, 1);
+
+    printk("%-15s %7llu %7llu %6u %6u %6u %6u %5u %5u %4u\n",
+           mode->name,
+           (unsigned long long)msgs * 1000000 / total_us,
+           (unsigned long long)BENCH_SAMPLES * 1000000 / total_us,
+           percentile(latency_us, rx_count, 50),
+           percentile(latency_us, rx_count, 90),
+           percentile(latency_us, rx_count, 99),
+           rx_count ? latency_us[rx_count - 1] : 0,
+           st.tx_bytes / msgs,
+           st.tx_bytes / BENCH_SAMPLES,
+           msgs - rx_count);
+}
+
+static void run_reconnect(void)
+{
+    uint32_t times[BENCH_RECONNECTS];
+    uint32_t n = 0;
+
+    for (int i = 0; i < BENCH_RECONNECTS; i++) {
+        mqtt_disconnect(&client_ctx);
+        while (mqtt_connected) {
+            bench_pump(1);
+        }
+
+        uint64_t start = bench_now_us();
+
+        if (app_mqtt_connect(&client_ctx) == 0) {
+            times[n++] = (uint32_t)(bench_now_us() - start);
+        }
+    }
+
+    qsort(times, n, sizeof(times[0]), cmp_u32);
+    printk("reconnect: %u/%u ok, median %u us, max %u us\n",
+           n, BENCH_RECONNECTS, percentile(times, n, 50),
+           n ? times[n - 1] : 0);
+}
+
+int main(void)
+{
+    mqtt_init();
+    if (app_mqtt_connect(&client_ctx) != 0) {
+        printk("Cannot reach broker, is mosquitto running on the host?\n");
+        return 0;
+    }
+
+    app_mqtt_set_rx_cb(bench_rx);
+    app_mqtt_subscribe(&client_ctx, BENCH_TOPIC, MQTT_QOS_1_AT_LEAST_ONCE);
+
+    // Let the SUBACK and anything queued from an earlier run go by
+    uint64_t settle = bench_now_us();
+    while (bench_now_us() - settle < 500000) {
+        bench_pump(10);
+    }
+
+    printk("MQTT %s, %d samples per mode\n",
+           client_ctx.protocol_version == MQTT_VERSION_3_1_1 ? "3.1.1" : "5.0",
+           BENCH_SAMPLES);
+    printk("%-15s %7s %7s %6s %6s %6s %6s %5s %5s %4s\n",
+           "mode", "msg/s", "smp/s", "p50us", "p90us", "p99us", "maxus",
+           "B/msg", "B/smp", "lost");
+
+    for (size_t i = 0; i < ARRAY_SIZE(modes); i++) {
+        run_mode(&modes[i]);
+    }
+
+    run_reconnect();
+
+    printk("Benchmark done\n");
+    return 0;
+}
@@ -0,0 +1,399 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "cbor_enc.h"
+#include "telemetry.h"
+
+// UTC milliseconds in 2025, needs more than 32 bits
+#define TS_UTC 1735689600123LL
+
+static uint8_t buf[256];
+
+// Independent CBOR reader, only what the telemetry schema uses
+struct cbor_reader {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool err;
+};
+
+static void reader_init(struct cbor_reader *r, const uint8_t *data, int len)
+{
+    r->buf = data;
+    r->len = len > 0 ? len : 0;
+    r->pos = 0;
+    r->err = len <= 0;
+}
+
+static bool get_head(struct cbor_reader *r, uint8_t *major, uint64_t *arg)
+{
+    uint8_t ib, info;
+    size_t n;
+
+    if (r->err || r->pos >= r->len) {
+        r->err = true;
+        return false;
+    }
+
+    ib = r->buf[r->pos++];
+    *major = ib >> 5;
+    info = ib & 0x1f;
+
+    if (info < 24) {
+        *arg = info;
+        return true;
+    }
+    if (info > 27) {
+        r->err = true;
+        return false;
+    }
+
+    n = 1 << (info - 24);
+    if (r->len - r->pos < n) {
+        r->err = true;
+        return false;
+    }
+
+    *arg = 0;
+    for (size_t i = 0; i < n; i++) {
+        *arg = (*arg << 8) | r->buf[r->pos++];
+    }
+
+    // The writer must always pick the shortest form
+    if ((n == 1 && *arg < 24) || (n > 1 && *arg >> (n * 4) == 0)) {
+        r->err = true;
+        return false;
+    }
+    return true;
+}
+
+static int64_t get_int(struct cbor_reader *r)
+{
+    uint8_t major;
+    uint64_t arg;
+
+    if (!get_head(r, &major, &arg)) {
+        return 0;
+    }
+    if ((major != 0 && major != 1) || arg > INT64_MAX) {
+        r->err = true;
+        return 0;
+    }
+    return major == 0 ? (int64_t)arg : -1 - (int64_t)arg;
+}
+
+static uint64_t get_uint(struct cbor_reader *r)
+{
+    uint8_t major;
+    uint64_t arg;
+
+    if (!get_head(r, &major, &arg) || major != 0) {
+        r->err = true;
+        return 0;
+    }
+    return arg;
+}
+
+// Read a head of the given major type and check its argument
+static void expect_head(struct cbor_reader *r, uint8_t major, uint64_t arg)
+{
+    uint8_t m;
+    uint64_t a;
+
+    if (get_head(r, &m, &a) && (m != major || a != arg)) {
+        r->err = true;
+    }
+}
+
+static void expect_int(struct cbor_reader *r, int64_t val)
+{
+    if (get_int(r) != val) {
+        r->err = true;
+    }
+}
+
+// Whole payload consumed without a mismatch
+static bool reader_done(const struct cbor_reader *r)
+{
+    return !r->err && r->pos == r->len;
+}
+
+static bool check_uint(uint64_t val, size_t expect_len)
+{
+    struct cbor_writer w;
+    struct cbor_reader r;
+    int len;
+
+    cbor_writer_init(&w, buf, sizeof(buf));
+    cbor_put_uint(&w, val);
+    len = cbor_writer_finish(&w);
+
+    reader_init(&r, buf, len);
+    return len == (int)expect_len && get_uint(&r) == val && reader_done(&r);
+}
+
+static bool check_int(int64_t val, size_t expect_len)
+{
+    struct cbor_writer w;
+    struct cbor_reader r;
+    int len;
+
+    cbor_writer_init(&w, buf, sizeof(buf));
+    cbor_put_int(&w, val);
+    len = cbor_writer_finish(&w);
+
+    reader_init(&r, buf, len);
+    return len == (int)expect_len && get_int(&r) == val && reader_done(&r);
+}
+
+static bool case_primitives(void)
+{
+    static const struct {
+        uint64_t val;
+        size_t len;
+    } uints[] = {
+        { 0, 1 }, { 23, 1 }, { 24, 2 }, { 255, 2 }, { 256, 3 },
+        { 65535, 3 }, { 65536, 5 }, { UINT32_MAX, 5 },
+        { (uint64_t)UINT32_MAX + 1, 9 }, { UINT64_MAX, 9 },
+    };
+    static const struct {
+        int64_t val;
+        size_t len;
+    } ints[] = {
+        { -1, 1 }, { -24, 1 }, { -25, 2 }, { -256, 2 }, { -257, 3 },
+        { -65537, 5 }, { -(int64_t)UINT32_MAX - 1, 5 },
+        { -(int64_t)UINT32_MAX - 2, 9 }, { INT64_MAX, 9 }, { INT64_MIN, 9 },
+        { TS_UTC, 9 }, { -TS_UTC, 9 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(uints); i++) {
+        if (!check_uint(uints[i].val, uints[i].len)) {
+            printk("  uint %llu\n", (unsigned long long)uints[i].val);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(ints); i++) {
+        if (!check_int(ints[i].val, ints[i].len)) {
+            printk("  int %lld\n", (long long)ints[i].val);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool case_strings(void)
+{
+    static const uint8_t blob[3] = { 0x00, 0xff, 0x7f };
+    struct cbor_writer w;
+    struct cbor_reader r;
+    int len;
+
+    cbor_writer_init(&w, buf, sizeof(buf));
+    cbor_put_array(&w, 4);
+    cbor_put_tstr(&w, "esp32");
+    cbor_put_bstr(&w, blob, sizeof(blob));
+    cbor_put_bool(&w, true);
+    cbor_put_bool(&w, false);
+    len = cbor_writer_finish(&w);
+
+    reader_init(&r, buf, len);
+    expect_head(&r, 4, 4);
+    expect_head(&r, 3, 5);
+    if (r.err || r.len - r.pos < 5 || memcmp(&buf[r.pos], "esp32", 5) != 0) {
+        return false;
+    }
+    r.pos += 5;
+    expect_head(&r, 2, sizeof(blob));
+    if (r.err || r.len - r.pos < sizeof(blob) ||
+        memcmp(&buf[r.pos], blob, sizeof(blob)) != 0) {
+        return false;
+    }
+    r.pos += sizeof(blob);
+    expect_head(&r, 7, 21);
+    expect_head(&r, 7, 20);
+    return reader_done(&r);
+}
+
+static bool case_overflow(void)
+{
+    struct cbor_writer w;
+
+    // The 8 byte argument does not fit, later small puts must not land
+    cbor_writer_init(&w, buf, 4);
+    cbor_put_uint(&w, UINT64_MAX);
+    cbor_put_uint(&w, 1);
+    return cbor_writer_finish(&w) == -ENOMEM && w.len == 0;
+}
+
+static bool case_sample(void)
+{
+    const struct sensor_snapshot snap = {
+        .temperature = -12,
+        .humidity = 87,
+        .timestamp_ms = TS_UTC,
+        .quality = SAMPLE_QUALITY_STALE,
+    };
+    struct cbor_reader r;
+    int len;
+
+    len = telemetry_encode_sample(buf, sizeof(buf), &snap);
+    reader_init(&r, buf, len);
+    expect_head(&r, 5, 4);
+    expect_int(&r, TELEM_KEY_TEMP);
+    expect_int(&r, -12);
+    expect_int(&r, TELEM_KEY_HUM);
+    expect_int(&r, 87);
+    expect_int(&r, TELEM_KEY_TS);
+    expect_int(&r, TS_UTC);
+    expect_int(&r, TELEM_KEY_QUALITY);
+    expect_int(&r, SAMPLE_QUALITY_STALE);
+    if (!reader_done(&r)) {
+        return false;
+    }
+
+    return telemetry_encode_sample(buf, len - 1, &snap) == -ENOMEM;
+}
+
+static bool case_batch(void)
+{
+    // Out of order entries give a negative delta from the base
+    const struct telemetry_record recs[] = {
+        { TS_UTC, -5, 30 },
+        { TS_UTC + 1000, -40, 100 },
+        { TS_UTC + 70000, 125, 0 },
+        { TS_UTC - 2000, 0, 55 },
+    };
+    struct cbor_reader r;
+    int len;
+
+    len = telemetry_encode_batch(buf, sizeof(buf), recs, ARRAY_SIZE(recs));
+    reader_init(&r, buf, len);
+    expect_head(&r, 5, 2);
+    expect_int(&r, TELEM_KEY_TS);
+    expect_int(&r, TS_UTC);
+    expect_int(&r, TELEM_KEY_RECORDS);
+    expect_head(&r, 4, ARRAY_SIZE(recs));
+    for (size_t i = 0; i < ARRAY_SIZE(recs); i++) {
+        expect_head(&r, 4, 3);
+        expect_int(&r, recs[i].timestamp_ms - TS_UTC);
+        expect_int(&r, recs[i].temperature);
+        expect_int(&r, recs[i].humidity);
+    }
+    if (!reader_done(&r)) {
+        return false;
+    }
+
+    return telemetry_encode_batch(buf, len - 1, recs, ARRAY_SIZE(recs)) == -ENOMEM;
+}
+
+static bool case_batch_empty(void)
+{
+    struct cbor_reader r;
+    int len;
+
+    len = telemetry_encode_batch(buf, sizeof(buf), NULL, 0);
+    reader_init(&r, buf, len);
+    expect_head(&r, 5, 2);
+    expect_int(&r, TELEM_KEY_TS);
+    expect_int(&r, 0);
+    expect_int(&r, TELEM_KEY_RECORDS);
+    expect_head(&r, 4, 0);
+    return reader_done(&r);
+}
+
+static bool case_series(void)
+{
+    static const int16_t values[] = {
+        -3, -2, 0, 23, 24, -24, -25, 300, INT16_MIN, INT16_MAX,
+    };
+    struct cbor_reader r;
+    int len;
+
+    len = telemetry_encode_series(buf, sizeof(buf), TELEM_KEY_TEMP,
+                                  TS_UTC, 600000, values, ARRAY_SIZE(values));
+    reader_init(&r, buf, len);
+    expect_head(&r, 5, 3);
+    expect_int(&r, TELEM_KEY_TS);
+    expect_int(&r, TS_UTC);
+    expect_int(&r, TELEM_KEY_INTERVAL);
+    expect_int(&r, 600000);
+    expect_int(&r, TELEM_KEY_TEMP);
+    expect_head(&r, 4, ARRAY_SIZE(values));
+    for (size_t i = 0; i < ARRAY_SIZE(values); i++) {
+        expect_int(&r, values[i]);
+    }
+    if (!reader_done(&r)) {
+        return false;
+    }
+
+    return telemetry_encode_series(buf, len - 1, TELEM_KEY_TEMP, TS_UTC, 600000,
+                                   values, ARRAY_SIZE(values)) == -ENOMEM;
+}
+
+static bool case_summary(void)
+{
+    const struct agg_summary sum = {
+        .start_ms = TS_UTC,
+        .duration_ms = UINT32_MAX,
+        .count = 3600,
+        .temp = { .min = -21, .max = -1, .mean_x10 = -5 },
+        .hum = { .min = 20, .max = 95, .mean_x10 = 574 },
+    };
+    struct cbor_reader r;
+    int len;
+
+    len = telemetry_encode_summary(buf, sizeof(buf), &sum);
+    reader_init(&r, buf, len);
+    expect_head(&r, 5, 5);
+    expect_int(&r, TELEM_KEY_TS);
+    expect_int(&r, TS_UTC);
+    expect_int(&r, TELEM_KEY_DURATION);
+    expect_int(&r, UINT32_MAX);
+    expect_int(&r, TELEM_KEY_COUNT);
+    expect_int(&r, 3600);
+    expect_int(&r, TELEM_KEY_TEMP);
+    expect_head(&r, 4, 3);
+    expect_int(&r, -21);
+    expect_int(&r, -1);
+    expect_int(&r, -5);
+    expect_int(&r, TELEM_KEY_HUM);
+    expect_head(&r, 4, 3);
+    expect_int(&r, 20);
+    expect_int(&r, 95);
+    expect_int(&r, 574);
+    if (!reader_done(&r)) {
+        return false;
+    }
+
+    return telemetry_encode_summary(buf, len - 1, &sum) == -ENOMEM;
+}
+
+static const struct {
+    const char *name;
+    bool (*run)(void);
+} cases[] = {
+    { "primitives", case_primitives },
+    { "strings", case_strings },
+    { "overflow", case_overflow },
+    { "sample", case_sample },
+    { "batch", case_batch },
+    { "batch empty", case_batch_empty },
+    { "series", case_series },
+    { "summary", case_summary },
+};
+
+int main(void)
+{
+    int passed = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+        bool pass = cases[i].run();
+
+        printk("%-12s %s\n", cases[i].name, pass ? "PASS" : "FAIL");
+        passed += pass;
+    }
+
+    printk("cbor_check: %d/%u passed\n", passed, (unsigned int)ARRAY_SIZE(cases));
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+
+#include "my_dht11.h"
+
+static const struct gpio_dt_spec dio = GPIO_DT_SPEC_GET(DT_NODELABEL(dht11), dio_gpios);
+
+#define GEN_THREAD_STACK_SIZE 1024
+#define GEN_THREAD_PRIORITY 2       // Above main, like the sensor is to the CPU
+
+// DHT11 needs 1 s between conversions
+#define CASE_GAP_MS 1000
+
+// One waveform to play and the result the decoder should produce
+struct sim_case {
+    const char *name;
+    uint8_t data[4];            // Humidity, humidity decimal, temperature, temperature decimal
+    int8_t checksum_error;      // Added to the checksum byte
+    int8_t jitter_us;           // Added to every low and high time, sign alternating per bit
+    uint8_t bits;               // Bits sent before the line goes quiet
+    bool glitch;                // Extra 5 us low pulse inside bit 10
+    int expect;                 // Return value of dht11_read()
+    int temp, hum;              // Expected reading when expect == 0
+};
+
+static const struct sim_case cases[] = {
+    { "nominal",      { 45, 0, 23, 0 },    0,   0, 40, false, 0,          23, 45 },
+    { "all ones",     { 0xff, 0xff, 0xff, 0x7f }, 0, 0, 40, false, 0,    255, 255 },
+    { "jitter",       { 60, 0, 19, 5 },    0,   6, 40, false, 0,          19, 60 },
+    { "negative",     { 80, 0, 5, 0x81 },  0,   0, 40, false, 0,          -5, 80 },
+    { "bad checksum", { 45, 0, 23, 0 },    1,   0, 40, false, -EBADMSG,    0,  0 },
+    { "glitch",       { 45, 0, 23, 0 },    0,   0, 40, true,  -EIO,        0,  0 },
+    { "truncated",    { 45, 0, 23, 0 },    0,   0, 20, false, -ETIMEDOUT,  0,  0 },
+};
+
+K_THREAD_STACK_DEFINE(gen_stack, GEN_THREAD_STACK_SIZE);
+static struct k_thread gen_thread;
+static K_SEM_DEFINE(gen_go, 0, 1);
+static const struct sim_case *gen_case;
+
+static void line_set(int value)
+{
+    gpio_emul_input_set(dio.port, dio.pin, value);
+}
+
+static void line_hold(uint32_t us, int jitter)
+{
+    k_busy_wait(us + jitter);
+}
+
+static bool host_is_driving(void)
+{
+    gpio_flags_t flags = 0;
+
+    gpio_emul_flags_get(dio.port, dio.pin, &flags);
+    return (flags & GPIO_OUTPUT) != 0;
+}
+
+// Play one frame the way a DHT11 would after the host start signal
+static void play_frame(const struct sim_case *c)
+{
+    uint8_t frame[5];
+    int j = c->jitter_us;
+
+    memcpy(frame, c->data, 4);
+    frame[4] = c->data[0] + c->data[1] + c->data[2] + c->data[3] + c->checksum_error;
+
+    // Wait for the start signal and for the host to release the line
+    while (!host_is_driving()) {
+        k_usleep(10);
+    }
+    while (host_is_driving()) {
+        k_usleep(10);
+    }
+    line_hold(30, 0);
+
+    // Response
+    line_set(0);
+    line_hold(80, j);
+    line_set(1);
+    line_hold(80, j);
+
+    // Jitter moves every period by twice its value, a bit past the datasheet
+    // spread of 70-85 us for a 0 and 116-130 us for a 1
+    for (int i = 0; i < c->bits; i++) {
+        bool one = frame[i / 8] & BIT(7 - i % 8);
+
+        j = -j;
+        line_set(0);
+        line_hold(50, j);
+        line_set(1);
+        if (c->glitch && i == 10) {
+            line_hold(10, 0);
+            line_set(0);
+            line_hold(5, 0);
+            line_set(1);
+        }
+        line_hold(one ? 70 : 27, j);
+    }
+
+    if (c->bits == 40) {
+        // End of frame, then the line is released
+        line_set(0);
+        line_hold(50, 0);
+    }
+    line_set(1);
+}
+
+// Waveform generator thread start function
+static void gen_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    while (1) {
+        k_sem_take(&gen_go, K_FOREVER);
+        play_frame(gen_case);
+    }
+}
+
+static bool run_case(const struct sim_case *c)
+{
+    int temp = 0, hum = 0;
+    int ret;
+
+    gen_case = c;
+    k_sem_give(&gen_go);
+    ret = dht11_read(&temp, &hum);
+
+    bool pass = ret == c->expect &&
+                (ret != 0 || (temp == c->temp && hum == c->hum));
+
+    printk("%-13s ret %4d T=%4d H=%3d  %s\n",
+           c->name, ret, temp, hum, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+int main(void)
+{
+    int passed = 0;
+
+    if (dht11_init() != 0) {
+        printk("DHT11 init failed\n");
+        return 0;
+    }
+
+    // Idle line is pulled high
+    line_set(1);
+
+    k_thread_create(&gen_thread,
+                    gen_stack,
+                    K_THREAD_STACK_SIZEOF(gen_stack),
+                    gen_thread_start,
+                    NULL, NULL, NULL,
+                    GEN_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&gen_thread, "dht_wave");
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+        passed += run_case(&cases[i]);
+        k_msleep(CASE_GAP_MS);
+    }
+
+    printk("dht_sim: %d/%u passed\n", passed, (unsigned int)ARRAY_SIZE(cases));
+    return 0;
+}
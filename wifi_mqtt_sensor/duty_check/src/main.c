@@ -0,0 +1,259 @@
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "duty.h"
+#include "timesync.h"
+#include "wifi_conn.h"
+
+// UTC milliseconds in 2025
+#define TS_UTC 1735689600000LL
+
+/* Stand-ins for the connectivity module and the clock model, only what
+ duty.c calls. The link comes up from a timer to test the early wake. */
+static bool link_ready = true;
+static K_SEM_DEFINE(link_up, 0, 1);
+static uint32_t ps_on_calls, ps_off_calls;
+
+static void link_timer_expiry(struct k_timer *timer)
+{
+    link_ready = true;
+    k_sem_give(&link_up);
+}
+
+static K_TIMER_DEFINE(link_timer, link_timer_expiry, NULL);
+
+bool wifi_conn_is_ready(void)
+{
+    return link_ready;
+}
+
+int wifi_conn_wait_ready(k_timeout_t timeout)
+{
+    if (link_ready) {
+        return 0;
+    }
+    return k_sem_take(&link_up, timeout) == 0 ? 0 : -EAGAIN;
+}
+
+int wifi_conn_set_power_save(bool enable)
+{
+    if (enable) {
+        ps_on_calls++;
+    } else {
+        ps_off_calls++;
+    }
+    return 0;
+}
+
+// Same threshold as timesync.c
+bool timestamp_is_utc(int64_t ts_ms)
+{
+    return ts_ms >= 1000000000000LL;
+}
+
+static bool check_eq(const char *what, int64_t got, int64_t want)
+{
+    if (got != want) {
+        printk("  %s: got %lld, want %lld\n", what, (long long)got, (long long)want);
+    }
+    return got == want;
+}
+
+#define CHECK_EQ(what, got, want) check_eq(what, (int64_t)(got), (int64_t)(want))
+
+static void reset_stubs(void)
+{
+    link_ready = true;
+    k_sem_reset(&link_up);
+    ps_on_calls = 0;
+    ps_off_calls = 0;
+}
+
+// One wake window the way main.c runs it, k_busy_wait() advances the
+// simulated clock by exactly the work time
+static void run_window(uint32_t work_ms)
+{
+    duty_window_begin();
+    duty_radio_active(true);
+    k_busy_wait(work_ms * USEC_PER_MSEC);
+    duty_radio_active(false);
+    duty_window_end();
+}
+
+// An hour of 10 s periods with 200 ms windows: every window on the grid,
+// 360 wakeups per hour, 2 % awake and radio on
+static bool case_grid(void)
+{
+    const int n = 360;
+    struct duty_stats st;
+    bool ok = true;
+
+    reset_stubs();
+    duty_init(10000);
+    int64_t t0 = k_uptime_get();
+
+    for (int i = 0; i < n; i++) {
+        int64_t at = k_uptime_get() - t0;
+
+        if (!CHECK_EQ("window start", at, (int64_t)i * 10000)) {
+            return false;
+        }
+        run_window(200);
+        if (!CHECK_EQ("grid sleep", duty_sleep(), true)) {
+            return false;
+        }
+    }
+
+    duty_stats_get(&st);
+    ok &= CHECK_EQ("wakeups", st.wakeups, (uint32_t)n);
+    ok &= CHECK_EQ("elapsed", st.elapsed_ms, (uint64_t)n * 10000);
+    ok &= CHECK_EQ("awake", st.awake_ms, (uint64_t)n * 200);
+    ok &= CHECK_EQ("radio on", st.radio_on_ms, (uint64_t)n * 200);
+    ok &= CHECK_EQ("wakeups/h", st.wakeups_per_hour, 360U);
+    ok &= CHECK_EQ("awake permille", st.awake_permille, 20U);
+    ok &= CHECK_EQ("radio permille", st.radio_permille, 20U);
+    // The radio starts active, so the first window needs no switch
+    ok &= CHECK_EQ("power save on", ps_on_calls, (uint32_t)n);
+    ok &= CHECK_EQ("power save off", ps_off_calls, (uint32_t)n - 1);
+    return ok;
+}
+
+// Windows longer than the period skip boundaries but stay on the grid
+static bool case_overrun(void)
+{
+    static const int64_t starts[] = { 0, 3000, 6000, 9000, 12000 };
+    struct duty_stats st;
+    bool ok = true;
+
+    reset_stubs();
+    duty_init(1000);
+    int64_t t0 = k_uptime_get();
+
+    for (size_t i = 0; i < ARRAY_SIZE(starts); i++) {
+        ok &= CHECK_EQ("window start", k_uptime_get() - t0, starts[i]);
+        run_window(2500);
+        duty_sleep();
+    }
+
+    duty_stats_get(&st);
+    ok &= CHECK_EQ("wakeups", st.wakeups, (uint32_t)ARRAY_SIZE(starts));
+    ok &= CHECK_EQ("elapsed", st.elapsed_ms, 15000ULL);
+    ok &= CHECK_EQ("awake", st.awake_ms, 12500ULL);
+    ok &= CHECK_EQ("awake permille", st.awake_permille, 833U);
+    return ok;
+}
+
+// Link comes up mid-period: an extra window right away, then back on the
+// grid at the next boundary
+static bool case_early_wake(void)
+{
+    struct duty_stats st;
+    bool ok = true;
+
+    reset_stubs();
+    duty_init(10000);
+    int64_t t0 = k_uptime_get();
+
+    link_ready = false;
+    run_window(200);
+    k_timer_start(&link_timer, K_MSEC(3500), K_NO_WAIT);
+
+    ok &= CHECK_EQ("first sleep", duty_sleep(), false);
+    ok &= CHECK_EQ("early wake at", k_uptime_get() - t0, 3700LL);
+
+    run_window(200);
+    ok &= CHECK_EQ("second sleep", duty_sleep(), true);
+    ok &= CHECK_EQ("grid wake at", k_uptime_get() - t0, 10000LL);
+
+    duty_stats_get(&st);
+    ok &= CHECK_EQ("wakeups", st.wakeups, 2U);
+    ok &= CHECK_EQ("awake", st.awake_ms, 400ULL);
+    return ok;
+}
+
+static void backlog_clear(void)
+{
+    duty_backlog_drop(duty_backlog_count());
+}
+
+static void push_ts(int64_t ts)
+{
+    struct telemetry_record rec = { .timestamp_ms = ts, .temperature = 21, .humidity = 40 };
+
+    duty_backlog_push(&rec);
+}
+
+// Full ring drops the oldest, peek and drop work from the oldest
+static bool case_backlog(void)
+{
+    struct telemetry_record recs[DUTY_BACKLOG_SIZE];
+    bool ok = true;
+    size_t n;
+
+    duty_init(1000);
+    backlog_clear();
+
+    for (int i = 0; i < DUTY_BACKLOG_SIZE + 8; i++) {
+        push_ts(TS_UTC + i);
+    }
+    ok &= CHECK_EQ("count", duty_backlog_count(), (size_t)DUTY_BACKLOG_SIZE);
+
+    n = duty_backlog_peek(recs, ARRAY_SIZE(recs));
+    ok &= CHECK_EQ("peeked", n, (size_t)DUTY_BACKLOG_SIZE);
+    ok &= CHECK_EQ("oldest", recs[0].timestamp_ms, TS_UTC + 8);
+    ok &= CHECK_EQ("newest", recs[n - 1].timestamp_ms, TS_UTC + DUTY_BACKLOG_SIZE + 7);
+
+    duty_backlog_drop(5);
+    n = duty_backlog_peek(recs, 1);
+    ok &= CHECK_EQ("count after drop", duty_backlog_count(), (size_t)DUTY_BACKLOG_SIZE - 5);
+    ok &= CHECK_EQ("oldest after drop", recs[0].timestamp_ms, TS_UTC + 13);
+    return ok;
+}
+
+// A re-init with a valid retained backlog, as after a warm reset, keeps
+// the UTC records in order and drops the uptime stamped ones
+static bool case_recover(void)
+{
+    struct telemetry_record recs[DUTY_BACKLOG_SIZE];
+    bool ok = true;
+    size_t n;
+
+    backlog_clear();
+    for (int i = 0; i < 10; i++) {
+        push_ts(i % 2 ? i * 1000 : TS_UTC + i);
+    }
+
+    duty_init(1000);
+    n = duty_backlog_peek(recs, ARRAY_SIZE(recs));
+    ok &= CHECK_EQ("kept", n, (size_t)5);
+    for (size_t i = 0; i < n; i++) {
+        ok &= CHECK_EQ("kept ts", recs[i].timestamp_ms, TS_UTC + 2 * (int64_t)i);
+    }
+    return ok;
+}
+
+static const struct {
+    const char *name;
+    bool (*run)(void);
+} cases[] = {
+    { "grid", case_grid },
+    { "overrun", case_overrun },
+    { "early wake", case_early_wake },
+    { "backlog", case_backlog },
+    { "recover", case_recover },
+};
+
+int main(void)
+{
+    int passed = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+        bool pass = cases[i].run();
+
+        printk("%-12s %s\n", cases[i].name, pass ? "PASS" : "FAIL");
+        passed += pass;
+    }
+
+    printk("duty_check: %d/%u passed\n", passed, (unsigned int)ARRAY_SIZE(cases));
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#include "aggregator.h"
+
+// Running statistics for one channel
+struct agg_channel {
+    int min;
+    int max;
+    int32_t sum;
+};
+
+static struct aggregator_config config;
+
+// Report-by-exception state
+static bool reported;
+static int last_temp;
+static int last_hum;
+static int64_t last_report_ms;
+
+// Current window
+static int64_t window_start_ms;
+static int64_t window_last_ms;
+static uint32_t window_count;
+static struct agg_channel win_temp;
+static struct agg_channel win_hum;
+
+// Closed window waiting for aggregator_take_summary()
+static struct agg_summary closed;
+
+static void channel_add(struct agg_channel *ch, int val, bool first)
+{
+    if (first) {
+        ch->min = val;
+        ch->max = val;
+        ch->sum = 0;
+    }
+    ch->min = MIN(ch->min, val);
+    ch->max = MAX(ch->max, val);
+    ch->sum += val;
+}
+
+static void channel_stats(const struct agg_channel *ch, uint32_t count,
+                          struct agg_stats *out)
+{
+    out->min = ch->min;
+    out->max = ch->max;
+    out->mean_x10 = count ? (ch->sum * 10) / (int32_t)count : 0;
+}
+
+void aggregator_init(const struct aggregator_config *cfg)
+{
+    config = *cfg;
+    reported = false;
+    window_count = 0;
+}
+
+void aggregator_set_config(const struct aggregator_config *cfg)
+{
+    config = *cfg;
+}
+
+void aggregator_get_config(struct aggregator_config *cfg)
+{
+    *cfg = config;
+}
+
+uint32_t aggregator_feed(const struct sensor_snapshot *snap)
+{
+    uint32_t events = 0;
+    int64_t now = snap->timestamp_ms;
+
+    // Close the window before adding a sample that falls past its end
+    if (config.window_ms && window_count &&
+        now - window_start_ms >= config.window_ms) {
+        closed.start_ms = window_start_ms;
+        closed.duration_ms = (uint32_t)(window_last_ms - window_start_ms);
+        closed.count = window_count;
+        channel_stats(&win_temp, window_count, &closed.temp);
+        channel_stats(&win_hum, window_count, &closed.hum);
+        window_count = 0;
+        events |= AGG_EVT_WINDOW;
+    }
+
+    if (window_count == 0) {
+        window_start_ms = now;
+    }
+    channel_add(&win_temp, snap->temperature, window_count == 0);
+    channel_add(&win_hum, snap->humidity, window_count == 0);
+    window_last_ms = now;
+    window_count++;
+
+    if (!reported ||
+        abs(snap->temperature - last_temp) > config.temp_deadband ||
+        abs(snap->humidity - last_hum) > config.hum_deadband) {
+        events |= AGG_EVT_CHANGE;
+    } else if (now - last_report_ms >= config.heartbeat_ms) {
+        events |= AGG_EVT_HEARTBEAT;
+    }
+
+    return events;
+}
+
+void aggregator_reported(const struct sensor_snapshot *snap)
+{
+    reported = true;
+    last_temp = snap->temperature;
+    last_hum = snap->humidity;
+    last_report_ms = snap->timestamp_ms;
+}
+
+void aggregator_take_summary(struct agg_summary *out)
+{
+    *out = closed;
+}
@@ -0,0 +1,53 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+#include "sampler.h"
+
+/* Report-by-exception settings
+ A sample is reported when a channel moves by more than its deadband from
+ the last reported value, or when nothing was reported for heartbeat_ms.
+ Independently every window_ms a min/max/mean/count summary is produced so
+ short excursions show up even if they stay inside the deadband.*/
+struct aggregator_config {
+    int temp_deadband;          // Degrees C
+    int hum_deadband;           // Percent RH
+    uint32_t heartbeat_ms;      // Max time between sample reports
+    uint32_t window_ms;         // Summary window length, 0 = no summaries
+};
+
+// Statistics of one channel over a window
+struct agg_stats {
+    int min;
+    int max;
+    int mean_x10;               // Mean in tenths, DHT11 values are integers
+};
+
+struct agg_summary {
+    int64_t start_ms;           // Timestamp of the first sample in the window
+    uint32_t duration_ms;
+    uint32_t count;
+    struct agg_stats temp;
+    struct agg_stats hum;
+};
+
+// Flags returned by aggregator_feed()
+#define AGG_EVT_CHANGE    BIT(0)    // A channel left its deadband
+#define AGG_EVT_HEARTBEAT BIT(1)    // Heartbeat interval elapsed
+#define AGG_EVT_WINDOW    BIT(2)    // Window closed, summary ready
+
+void aggregator_init(const struct aggregator_config *cfg);
+void aggregator_set_config(const struct aggregator_config *cfg);
+void aggregator_get_config(struct aggregator_config *cfg);
+
+// Feed one new good sample, returns AGG_EVT_* flags
+uint32_t aggregator_feed(const struct sensor_snapshot *snap);
+
+// Record that snap was published, resets deadband reference and heartbeat
+void aggregator_reported(const struct sensor_snapshot *snap);
+
+// Copy the summary of the window closed by the last AGG_EVT_WINDOW
+void aggregator_take_summary(struct agg_summary *out);
+
+#endif // AGGREGATOR_H
@@ -0,0 +1,13 @@
+#ifndef CA_CERT_H
+#define CA_CERT_H
+
+/* CA certificate of the MQTT broker (PEM, NUL terminated)
+ Generated at build time from the file in MQTT_CA_CERT, by default
+ certs/ca.crt. For a local mosquitto test setup that is the ca.crt used in
+ its cafile option. The configure step fails if the file is missing.*/
+static const unsigned char ca_cert[] = {
+#include "ca_cert.pem.inc"
+    0x00
+};
+
+#endif // CA_CERT_H
@@ -0,0 +1,126 @@
+#include <errno.h>
+#include <string.h>
+
+#include "cbor_enc.h"
+
+// CBOR major types (upper 3 bits of the initial byte)
+#define CBOR_MT_UINT   0
+#define CBOR_MT_NINT   1
+#define CBOR_MT_BSTR   2
+#define CBOR_MT_TSTR   3
+#define CBOR_MT_ARRAY  4
+#define CBOR_MT_MAP    5
+#define CBOR_MT_SIMPLE 7
+
+#define CBOR_SIMPLE_FALSE 20
+#define CBOR_SIMPLE_TRUE  21
+
+void cbor_writer_init(struct cbor_writer *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = false;
+}
+
+static bool reserve(struct cbor_writer *w, size_t n)
+{
+    if (w->overflow || w->size - w->len < n) {
+        w->overflow = true;
+        return false;
+    }
+    return true;
+}
+
+// Write the initial byte plus the shortest argument encoding
+static void put_head(struct cbor_writer *w, uint8_t major, uint64_t arg)
+{
+    uint8_t mt = major << 5;
+    size_t n;
+
+    if (arg < 24) {
+        if (reserve(w, 1)) {
+            w->buf[w->len++] = mt | (uint8_t)arg;
+        }
+        return;
+    }
+
+    if (arg <= UINT8_MAX) {
+        n = 1;
+        mt |= 24;
+    } else if (arg <= UINT16_MAX) {
+        n = 2;
+        mt |= 25;
+    } else if (arg <= UINT32_MAX) {
+        n = 4;
+        mt |= 26;
+    } else {
+        n = 8;
+        mt |= 27;
+    }
+
+    if (!reserve(w, n + 1)) {
+        return;
+    }
+
+    // Big-endian argument
+    w->buf[w->len++] = mt;
+    for (size_t i = n; i > 0; i--) {
+        w->buf[w->len++] = (uint8_t)(arg >> ((i - 1) * 8));
+    }
+}
+
+void cbor_put_uint(struct cbor_writer *w, uint64_t val)
+{
+    put_head(w, CBOR_MT_UINT, val);
+}
+
+void cbor_put_int(struct cbor_writer *w, int64_t val)
+{
+    if (val >= 0) {
+        put_head(w, CBOR_MT_UINT, (uint64_t)val);
+    } else {
+        // Negative integers are stored as -1 - n
+        put_head(w, CBOR_MT_NINT, (uint64_t)(-1 - val));
+    }
+}
+
+void cbor_put_bstr(struct cbor_writer *w, const uint8_t *data, size_t len)
+{
+    put_head(w, CBOR_MT_BSTR, len);
+    if (reserve(w, len)) {
+        memcpy(&w->buf[w->len], data, len);
+        w->len += len;
+    }
+}
+
+void cbor_put_tstr(struct cbor_writer *w, const char *str)
+{
+    size_t len = strlen(str);
+
+    put_head(w, CBOR_MT_TSTR, len);
+    if (reserve(w, len)) {
+        memcpy(&w->buf[w->len], str, len);
+        w->len += len;
+    }
+}
+
+void cbor_put_array(struct cbor_writer *w, size_t count)
+{
+    put_head(w, CBOR_MT_ARRAY, count);
+}
+
+void cbor_put_map(struct cbor_writer *w, size_t count)
+{
+    put_head(w, CBOR_MT_MAP, count);
+}
+
+void cbor_put_bool(struct cbor_writer *w, bool val)
+{
+    put_head(w, CBOR_MT_SIMPLE, val ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+}
+
+int cbor_writer_finish(const struct cbor_writer *w)
+{
+    return w->overflow ? -ENOMEM : (int)w->len;
+}
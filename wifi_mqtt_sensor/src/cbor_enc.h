@@ -0,0 +1,32 @@
+#ifndef CBOR_ENC_H
+#define CBOR_ENC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Minimal CBOR (RFC 8949) writer
+ Encodes straight into a caller supplied buffer, no heap and only a few
+ bytes of stack. Once the buffer is full the writer latches the overflow
+ flag and every later put is ignored, so callers only check once at the end.*/
+struct cbor_writer {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+};
+
+void cbor_writer_init(struct cbor_writer *w, uint8_t *buf, size_t size);
+
+void cbor_put_uint(struct cbor_writer *w, uint64_t val);
+void cbor_put_int(struct cbor_writer *w, int64_t val);
+void cbor_put_bstr(struct cbor_writer *w, const uint8_t *data, size_t len);
+void cbor_put_tstr(struct cbor_writer *w, const char *str);
+void cbor_put_array(struct cbor_writer *w, size_t count);
+void cbor_put_map(struct cbor_writer *w, size_t count);
+void cbor_put_bool(struct cbor_writer *w, bool val);
+
+// Number of bytes written, or -ENOMEM if the buffer was too small
+int cbor_writer_finish(const struct cbor_writer *w);
+
+#endif // CBOR_ENC_H
@@ -0,0 +1,223 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+
+#include "control.h"
+#include "mqtt_src.h"
+
+LOG_MODULE_REGISTER(control);
+
+#define CMD_MAX_LEN 96
+// Commands the broker may deliver in one wake window before control_poll()
+#define CMD_QUEUE_LEN 4
+
+// One tunable, all fields of struct app_settings are int32_t
+struct command {
+    const char *key;
+    size_t offset;
+    int32_t min;
+    int32_t max;
+};
+
+static const struct command commands[] = {
+    { "rate", offsetof(struct app_settings, sample_ms),     1000, 3600000 },
+    { "win",  offsetof(struct app_settings, window_ms),     0,    86400000 },
+    { "hb",   offsetof(struct app_settings, heartbeat_ms),  1000, 86400000 },
+    { "tdb",  offsetof(struct app_settings, temp_deadband), 0,    50 },
+    { "hdb",  offsetof(struct app_settings, hum_deadband),  0,    100 },
+    { "qos",  offsetof(struct app_settings, qos),           0,    1 },
+};
+
+static struct app_settings current;
+static control_apply_cb_t apply_cb;
+
+static char cmd_topic[48];
+static char ack_topic[52];
+static char ack_buf[96];
+
+// Filled by the MQTT receive callback, drained by control_poll()
+struct cmd_text {
+    char text[CMD_MAX_LEN + 1];
+};
+
+K_MSGQ_DEFINE(cmd_queue, sizeof(struct cmd_text), CMD_QUEUE_LEN, 1);
+
+static int32_t *field(struct app_settings *cfg, const struct command *cmd)
+{
+    return (int32_t *)((uint8_t *)cfg + cmd->offset);
+}
+
+/* Settings subsystem handler for app/cfg */
+static int cfg_set(const char *name, size_t len, settings_read_cb read_cb,
+                   void *cb_arg)
+{
+    const char *next;
+    struct app_settings loaded;
+
+    if (!settings_name_steq(name, "cfg", &next) || next) {
+        return -ENOENT;
+    }
+
+    // Layout changed since it was saved, keep the defaults
+    if (len != sizeof(loaded)) {
+        return -EINVAL;
+    }
+
+    if (read_cb(cb_arg, &loaded, len) != len) {
+        return -EIO;
+    }
+
+    // Same limits as a command, a corrupt or stale blob keeps the defaults
+    for (size_t i = 0; i < ARRAY_SIZE(commands); i++) {
+        int32_t val = *field(&loaded, &commands[i]);
+
+        if (val < commands[i].min || val > commands[i].max) {
+            LOG_WRN("Saved %s=%d out of range, using defaults",
+                    commands[i].key, (int)val);
+            return -EINVAL;
+        }
+    }
+
+    current = loaded;
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(app_cfg, "app", NULL, cfg_set, NULL, NULL);
+
+static void on_message(const char *topic, size_t topic_len,
+                       const uint8_t *payload, size_t len)
+{
+    if (topic_len != strlen(cmd_topic) ||
+        strncmp(topic, cmd_topic, topic_len) != 0) {
+        return;
+    }
+
+    if (len > CMD_MAX_LEN) {
+        LOG_WRN("Command too long (%u bytes)", len);
+        return;
+    }
+
+    struct cmd_text cmd;
+
+    memcpy(cmd.text, payload, len);
+    cmd.text[len] = '\0';
+    // Already acknowledged to the broker, so a drop can only be logged
+    if (k_msgq_put(&cmd_queue, &cmd, K_NO_WAIT) != 0) {
+        LOG_WRN("Command queue full, dropped: %s", cmd.text);
+    }
+}
+
+int control_init(const struct app_settings *defaults, control_apply_cb_t apply)
+{
+    current = *defaults;
+    apply_cb = apply;
+
+    int ret = settings_subsys_init();
+    if (ret == 0) {
+        ret = settings_load_subtree("app");
+    }
+    if (ret) {
+        LOG_ERR("Settings load failed (%d), using defaults", ret);
+    }
+
+    // Built here and not on subscribe, a resumed session skips that
+    snprintf(cmd_topic, sizeof(cmd_topic), "esp32/%s/cmd", app_mqtt_client_id());
+    snprintf(ack_topic, sizeof(ack_topic), "%s/ack", cmd_topic);
+
+    apply_cb(&current);
+    app_mqtt_set_rx_cb(on_message);
+    return ret;
+}
+
+int control_subscribe(struct mqtt_client *client)
+{
+    // QoS 1 so commands sent while we sleep are queued by the broker
+    return app_mqtt_subscribe(client, cmd_topic, MQTT_QOS_1_AT_LEAST_ONCE);
+}
+
+static const struct command *find_command(const char *key)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(commands); i++) {
+        if (strcmp(commands[i].key, key) == 0) {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+// Parse "key=value ..." into cfg, returns the offending token or NULL
+static const char *parse(char *text, struct app_settings *cfg)
+{
+    char *save;
+
+    for (char *tok = strtok_r(text, " ,;\r\n", &save); tok != NULL;
+         tok = strtok_r(NULL, " ,;\r\n", &save)) {
+        if (strcmp(tok, "get") == 0) {
+            continue;
+        }
+
+        char *eq = strchr(tok, '=');
+        if (eq == NULL) {
+            return tok;
+        }
+        *eq = '\0';
+
+        const struct command *cmd = find_command(tok);
+        char *end;
+        long val = strtol(eq + 1, &end, 10);
+
+        if (cmd == NULL || *end != '\0' || end == eq + 1 ||
+            val < cmd->min || val > cmd->max) {
+            return tok;
+        }
+        *field(cfg, cmd) = (int32_t)val;
+    }
+    return NULL;
+}
+
+static void handle_command(struct mqtt_client *client, char *text)
+{
+    struct app_settings cfg = current;
+    const char *bad;
+    int len;
+
+    LOG_INF("Command: %s", text);
+    bad = parse(text, &cfg);
+
+    if (bad != NULL) {
+        len = snprintf(ack_buf, sizeof(ack_buf), "err %s", bad);
+    } else {
+        if (memcmp(&cfg, &current, sizeof(cfg)) != 0) {
+            current = cfg;
+            apply_cb(&current);
+
+            int ret = settings_save_one("app/cfg", &current, sizeof(current));
+            if (ret) {
+                LOG_ERR("Failed to persist settings (%d)", ret);
+            }
+        }
+
+        len = snprintf(ack_buf, sizeof(ack_buf), "ok");
+        for (size_t i = 0; i < ARRAY_SIZE(commands); i++) {
+            len += snprintf(&ack_buf[len], sizeof(ack_buf) - len, " %s=%d",
+                            commands[i].key, (int)*field(&current, &commands[i]));
+        }
+    }
+
+    app_mqtt_publish_raw(client, ack_topic, (const uint8_t *)ack_buf,
+                         MIN((size_t)len, sizeof(ack_buf) - 1));
+}
+
+void control_poll(struct mqtt_client *client)
+{
+    struct cmd_text cmd;
+
+    // In arrival order, each one acked on its own
+    while (k_msgq_get(&cmd_queue, &cmd, K_NO_WAIT) == 0) {
+        handle_command(client, cmd.text);
+    }
+}
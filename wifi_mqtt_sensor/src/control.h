@@ -0,0 +1,43 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+
+/* Remotely tunable settings, persisted with the settings subsystem (NVS)
+ Commands arrive on esp32/<client id>/cmd as space separated key=value
+ pairs, for example "rate=10000 tdb=2 qos=1". The client id is unique per
+ unit, see app_mqtt_client_id(). All pairs of one message are
+ validated before any is applied. "get" on its own just reports. The
+ resulting settings (or the first bad key) are published on .../cmd/ack.
+
+   rate  sample period ms (duty period in duty-cycle mode, capped there)
+   win   summary window ms, 0 = off
+   hb    heartbeat ms
+   tdb   temperature deadband C
+   hdb   humidity deadband %RH
+   qos   publish QoS, 0 or 1 */
+struct app_settings {
+    int32_t sample_ms;
+    int32_t window_ms;
+    int32_t heartbeat_ms;
+    int32_t temp_deadband;
+    int32_t hum_deadband;
+    int32_t qos;
+};
+
+/* Puts cfg into effect. It may adjust cfg to the values actually in use
+ (for example a capped period), those are what is saved and acked. */
+typedef void (*control_apply_cb_t)(struct app_settings *cfg);
+
+// Load persisted settings over the defaults and apply them through apply
+int control_init(const struct app_settings *defaults, control_apply_cb_t apply);
+
+// Subscribe to the command topic (not needed when the session was resumed)
+int control_subscribe(struct mqtt_client *client);
+
+// Handle the received commands in order, call from the thread that runs
+// mqtt_input()
+void control_poll(struct mqtt_client *client);
+
+#endif // CONTROL_H
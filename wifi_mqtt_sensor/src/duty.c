@@ -0,0 +1,183 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "duty.h"
+#include "timesync.h"
+#include "wifi_conn.h"
+
+LOG_MODULE_REGISTER(duty);
+
+// Marks the retained backlog as valid, anything else means cold boot
+#define BACKLOG_MAGIC 0x44555459
+
+static uint32_t period_ms;
+static int64_t next_wake_ms;
+static int64_t start_ms;
+
+static uint32_t wakeups;
+static uint64_t awake_ms;
+static uint64_t radio_on_ms;
+static int64_t window_start_ms;
+static int64_t radio_on_since_ms;
+static bool radio_active;
+
+// Backlog ring buffer, left alone by the C startup code. Main SRAM, so it
+// survives a warm reset but not deep sleep.
+static __noinit struct {
+    uint32_t magic;
+    uint32_t head;              // Index of the oldest record
+    uint32_t count;
+    struct telemetry_record recs[DUTY_BACKLOG_SIZE];
+} backlog;
+
+// Records stamped before the first SNTP sync hold the uptime of the boot
+// that queued them. After a reset that uptime means nothing, resolving it
+// against the new boot's clock would publish a wrong time, so drop them.
+static void backlog_drop_unresolved(void)
+{
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < backlog.count; i++) {
+        const struct telemetry_record *rec =
+            &backlog.recs[(backlog.head + i) % DUTY_BACKLOG_SIZE];
+
+        if (timestamp_is_utc(rec->timestamp_ms)) {
+            backlog.recs[(backlog.head + kept) % DUTY_BACKLOG_SIZE] = *rec;
+            kept++;
+        }
+    }
+
+    if (kept < backlog.count) {
+        LOG_WRN("Dropped %u retained samples without wall clock time",
+                backlog.count - kept);
+    }
+    backlog.count = kept;
+}
+
+void duty_init(uint32_t period)
+{
+    period_ms = period;
+    start_ms = k_uptime_get();
+    next_wake_ms = start_ms;
+    wakeups = 0;
+    awake_ms = 0;
+    radio_on_ms = 0;
+    radio_active = true;
+    radio_on_since_ms = start_ms;
+
+    if (backlog.magic != BACKLOG_MAGIC || backlog.head >= DUTY_BACKLOG_SIZE ||
+        backlog.count > DUTY_BACKLOG_SIZE) {
+        backlog.magic = BACKLOG_MAGIC;
+        backlog.head = 0;
+        backlog.count = 0;
+    } else if (backlog.count) {
+        backlog_drop_unresolved();
+        LOG_INF("Recovered %u retained samples", backlog.count);
+    }
+}
+
+void duty_set_period(uint32_t period)
+{
+    period_ms = period;
+}
+
+void duty_window_begin(void)
+{
+    window_start_ms = k_uptime_get();
+    wakeups++;
+}
+
+void duty_window_end(void)
+{
+    awake_ms += k_uptime_get() - window_start_ms;
+}
+
+void duty_radio_active(bool active)
+{
+    int64_t now = k_uptime_get();
+
+    if (active == radio_active) {
+        return;
+    }
+
+    int ret = wifi_conn_set_power_save(!active);
+    if (ret < 0) {
+        LOG_DBG("WiFi power save not available (%d)", ret);
+    }
+
+    if (active) {
+        radio_on_since_ms = now;
+    } else {
+        radio_on_ms += now - radio_on_since_ms;
+    }
+    radio_active = active;
+}
+
+bool duty_sleep(void)
+{
+    int64_t now = k_uptime_get();
+
+    // Stay on the period grid, skip boundaries a long window overran
+    do {
+        next_wake_ms += period_ms;
+    } while (next_wake_ms <= now);
+
+    if (!wifi_conn_is_ready() &&
+        wifi_conn_wait_ready(K_TIMEOUT_ABS_MS(next_wake_ms)) == 0 &&
+        k_uptime_get() < next_wake_ms) {
+        // Run an extra window now, the next one stays on the grid
+        next_wake_ms -= period_ms;
+        return false;
+    }
+
+    k_sleep(K_TIMEOUT_ABS_MS(next_wake_ms));
+    return true;
+}
+
+void duty_stats_get(struct duty_stats *out)
+{
+    int64_t now = k_uptime_get();
+    uint64_t elapsed = MAX(now - start_ms, 1);
+
+    out->wakeups = wakeups;
+    out->awake_ms = awake_ms;
+    out->radio_on_ms = radio_on_ms + (radio_active ? now - radio_on_since_ms : 0);
+    out->elapsed_ms = elapsed;
+    out->wakeups_per_hour = (uint32_t)((uint64_t)wakeups * 3600000U / elapsed);
+    out->awake_permille = (uint32_t)(out->awake_ms * 1000U / elapsed);
+    out->radio_permille = (uint32_t)(out->radio_on_ms * 1000U / elapsed);
+}
+
+void duty_backlog_push(const struct telemetry_record *rec)
+{
+    if (backlog.count == DUTY_BACKLOG_SIZE) {
+        // Full: overwrite the oldest entry
+        backlog.head = (backlog.head + 1) % DUTY_BACKLOG_SIZE;
+        backlog.count--;
+    }
+
+    backlog.recs[(backlog.head + backlog.count) % DUTY_BACKLOG_SIZE] = *rec;
+    backlog.count++;
+}
+
+size_t duty_backlog_count(void)
+{
+    return backlog.count;
+}
+
+size_t duty_backlog_peek(struct telemetry_record *out, size_t max)
+{
+    size_t n = MIN(max, backlog.count);
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = backlog.recs[(backlog.head + i) % DUTY_BACKLOG_SIZE];
+    }
+    return n;
+}
+
+void duty_backlog_drop(size_t count)
+{
+    count = MIN(count, backlog.count);
+    backlog.head = (backlog.head + count) % DUTY_BACKLOG_SIZE;
+    backlog.count -= count;
+}
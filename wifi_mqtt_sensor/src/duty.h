@@ -0,0 +1,61 @@
+#ifndef DUTY_H
+#define DUTY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+/* Duty-cycle scheduler
+ All work (sampling, publishing, MQTT keepalive) happens in one wake window
+ per period. Between windows the main thread sleeps until the next aligned
+ boundary, the CPU idles and WiFi is in power save (modem sleep between
+ beacons). The build does not enable CONFIG_PM, so the SoC itself does not
+ enter light sleep; the association and the MQTT session stay up.*/
+
+// Counters to verify the savings, all times are k_uptime based so they also
+// work with the simulated clock on native_sim
+struct duty_stats {
+    uint32_t wakeups;           // Windows run since duty_init()
+    uint64_t awake_ms;          // Time spent inside windows
+    uint64_t radio_on_ms;       // Time with WiFi power save disabled
+    uint64_t elapsed_ms;        // Time since duty_init()
+    uint32_t wakeups_per_hour;
+    uint32_t awake_permille;
+    uint32_t radio_permille;
+};
+
+void duty_init(uint32_t period_ms);
+void duty_set_period(uint32_t period_ms);
+
+// Mark the start and end of a wake window
+void duty_window_begin(void);
+void duty_window_end(void);
+
+// Switch the radio to full power for the window (or back to power save)
+void duty_radio_active(bool active);
+
+// Sleep until the next window boundary. While the network is down, wake
+// as soon as it comes up so queued reports go out without waiting a whole
+// period; returns false for such an early wake (the boundary is kept).
+bool duty_sleep(void);
+
+void duty_stats_get(struct duty_stats *out);
+
+/* Retained sample backlog
+ Reports that could not be sent yet, kept in RAM that is not cleared at
+ boot (__noinit) so they survive warm resets such as a watchdog or
+ sys_reboot(). Deep sleep powers that RAM down, the app does not use it.
+ Oldest entries are dropped when full. Entries of an earlier boot that
+ still carry uptime instead of UTC are dropped by duty_init(), their time
+ cannot be recovered.*/
+#define DUTY_BACKLOG_SIZE 32
+
+void duty_backlog_push(const struct telemetry_record *rec);
+size_t duty_backlog_count(void);
+// Copy up to max oldest records, returns the number copied
+size_t duty_backlog_peek(struct telemetry_record *out, size_t max);
+// Drop the count oldest records after they were sent
+void duty_backlog_drop(size_t count);
+
+#endif // DUTY_H
@@ -1,17 +1,28 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/net/http/client.h>
 #include <zephyr/net/mqtt.h>
 #include <zephyr/drivers/sensor.h>
-#include "wifi.h"
+#include "wifi_conn.h"
 #include "mqtt_src.h"
 #include "my_dht11.h"
+#include "sampler.h"
+#include "telemetry.h"
+#include "aggregator.h"
+#include "timesync.h"
+#include "duty.h"
+#include "control.h"
 
 LOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
 extern struct mqtt_client client_ctx;
 extern bool mqtt_connected;
+extern bool mqtt_session_present;
+
+// Time between MQTT reconnect attempts
+#define MQTT_RECONNECT_MS 5000
 
 // Custom libraries
 
@@ -19,130 +30,401 @@ extern bool mqtt_connected;
 #define WIFI_SSID "Vodafone-0F19"
 #define WIFI_PSK "baxXcWaHLt9J4xj7"
 
-// HTTP GET settings
-#define HTTP_HOST "example.com"
-#define HTTP_URL "/"
+// Payload format: 1 = compact CBOR (see telemetry.h), 0 = JSON text
+#define PAYLOAD_CBOR 1
+#define CBOR_TOPIC "esp32/sensor/dht11/cbor"
+#define JSON_TOPIC "esp32/sensor/dht11"
+#define CBOR_SUMMARY_TOPIC "esp32/sensor/dht11/cbor/summary"
+#define JSON_SUMMARY_TOPIC "esp32/sensor/dht11/summary"
+
+// Report-by-exception defaults: DHT11 readings are integers that flicker by
+// one count, so only publish on a real move, otherwise a slow heartbeat and
+// one summary per window
+#define TEMP_DEADBAND 1             // C
+#define HUM_DEADBAND 2              // %RH
+#define HEARTBEAT_MS (15 * 60 * 1000)
+#define SUMMARY_WINDOW_MS (5 * 60 * 1000)
+
+// Duty-cycle mode: 1 = sample, publish and service MQTT in one wake window
+// per period with WiFi power save in between, 0 = sample every 2 s and poll
+// MQTT every 100 ms
+#define DUTY_CYCLE_MODE 1
+#define DUTY_PERIOD_MS 30000
+#define DUTY_MAX_PERIOD_MS 50000    // Must stay below the 60 s MQTT keepalive
+#define DUTY_LINGER_MS 200          // Window time left for broker traffic
+#define DUTY_REPORT_MS (60 * 60 * 1000)
+
+// Max reports combined into one batch message when flushing the backlog
+#define PUBLISH_BATCH_MAX 8
+
+// MQTT 5.0 metadata: a queued reading is superseded by the next heartbeat
+// at the latest, and the schema id travels as a user property instead of
+// in the payload
+static struct app_mqtt_meta cbor_meta = {
+    .expiry_s = HEARTBEAT_MS / 1000,
+    .prop_name = "schema",
+    .prop_value = "dht11-cbor/1",
+};
 
 // Globals
+// The MQTT library sends the payload straight from this buffer, so encoding
+// here means no intermediate copy and nothing on the main stack
+static uint8_t payload_buf[128];
 //static char response[512];
 
-// Print the results of a DNS lookup
-void print_addrinfo(struct zsock_addrinfo **results)
+// Boot timing, k_uptime_get() of the first good sample and the first report
+// that reached the broker (-1 until then)
+static int64_t first_sample_ms = -1;
+static int64_t first_publish_ms = -1;
+
+// Publish backlog records, one sample message or one batch message.
+// Returns the number of records that reached the client, which is less
+// than count if a JSON publish failed partway, or a negative error if none.
+static int publish_records(const struct telemetry_record *recs, size_t count)
+{
+#if PAYLOAD_CBOR
+    int len;
+    int rc;
+
+    if (count == 1) {
+        const struct sensor_snapshot snap = {
+            .temperature = recs[0].temperature,
+            .humidity = recs[0].humidity,
+            .timestamp_ms = recs[0].timestamp_ms,
+            .quality = SAMPLE_QUALITY_GOOD,
+        };
+        len = telemetry_encode_sample(payload_buf, sizeof(payload_buf), &snap);
+    } else {
+        len = telemetry_encode_batch(payload_buf, sizeof(payload_buf), recs, count);
+    }
+    if (len < 0) {
+        return len;
+    }
+    rc = app_mqtt_publish_ex(&client_ctx, CBOR_TOPIC, payload_buf, len,
+                             &cbor_meta);
+    return rc < 0 ? rc : (int)count;
+#else
+    // One message per record, the ones already sent must not go out again
+    for (size_t i = 0; i < count; i++) {
+        int rc;
+
+        snprintf((char *)payload_buf, sizeof(payload_buf),
+                 "{\"temperature\": %d, \"humidity\": %d, \"ts\": %lld}",
+                 recs[i].temperature, recs[i].humidity,
+                 (long long)recs[i].timestamp_ms);
+
+        rc = app_mqtt_publish(&client_ctx, JSON_TOPIC, (char *)payload_buf);
+        if (rc < 0) {
+            return i > 0 ? (int)i : rc;
+        }
+    }
+    return count;
+#endif
+}
+
+// Publish a window summary, returns the message id or a negative error
+static int publish_summary(const struct agg_summary *sum)
+{
+#if PAYLOAD_CBOR
+    struct agg_summary out = *sum;
+
+    out.start_ms = timestamp_from_uptime(sum->start_ms);
+
+    int len = telemetry_encode_summary(payload_buf, sizeof(payload_buf), &out);
+    if (len < 0) {
+        return len;
+    }
+    return app_mqtt_publish_raw(&client_ctx, CBOR_SUMMARY_TOPIC, payload_buf, len);
+#else
+    static char json[128];
+
+    snprintf(json, sizeof(json),
+             "{\"n\": %u, \"t\": [%d, %d, %s%d.%d], \"h\": [%d, %d, %s%d.%d]}",
+             sum->count,
+             sum->temp.min, sum->temp.max,
+             sum->temp.mean_x10 < 0 ? "-" : "",
+             abs(sum->temp.mean_x10) / 10, abs(sum->temp.mean_x10) % 10,
+             sum->hum.min, sum->hum.max,
+             sum->hum.mean_x10 < 0 ? "-" : "",
+             abs(sum->hum.mean_x10) / 10, abs(sum->hum.mean_x10) % 10);
+
+    return app_mqtt_publish(&client_ctx, JSON_SUMMARY_TOPIC, json);
+#endif
+}
+
+
+// Apply settings received over the downlink (or loaded from flash)
+static void apply_settings(struct app_settings *cfg)
+{
+    const struct aggregator_config agg_cfg = {
+        .temp_deadband = cfg->temp_deadband,
+        .hum_deadband = cfg->hum_deadband,
+        .heartbeat_ms = cfg->heartbeat_ms,
+        .window_ms = cfg->window_ms,
+    };
+
+    aggregator_set_config(&agg_cfg);
+#if DUTY_CYCLE_MODE
+    // Written back so the command ack reports the period in use
+    cfg->sample_ms = MIN(cfg->sample_ms, DUTY_MAX_PERIOD_MS);
+    duty_set_period(cfg->sample_ms);
+#else
+    sampler_set_period(cfg->sample_ms);
+#endif
+    cbor_meta.qos = cfg->qos;
+
+    LOG_INF("Settings: rate %d ms, window %d ms, heartbeat %d ms, "
+            "deadband %d C / %d %%, QoS %d",
+            (int)cfg->sample_ms, (int)cfg->window_ms, (int)cfg->heartbeat_ms,
+            (int)cfg->temp_deadband, (int)cfg->hum_deadband, (int)cfg->qos);
+}
+
+// Connect and make sure the command topic is subscribed. A resumed
+// persistent session still has the subscription, so skip it then.
+static int connect_and_subscribe(void)
+{
+    int rc = app_mqtt_connect(&client_ctx);
+
+    if (rc == 0 && !mqtt_session_present) {
+        control_subscribe(&client_ctx);
+    }
+    return rc;
+}
+
+// Bring up everything that needs the network once WiFi has an address.
+// Returns false while the network is still coming up.
+static bool network_start(void)
+{
+    if (!wifi_conn_is_ready()) {
+        return false;
+    }
+
+    wifi_conn_print_status();
+
+    // Keep uptime to UTC conversion up to date in the background, the first
+    // sync runs while the broker connection below is set up
+    timesync_start();
+
+    mqtt_init();
+    connect_and_subscribe();
+    return true;
+}
+
+static void print_boot_timing(void)
+{
+    struct wifi_conn_stats ws;
+
+    wifi_conn_stats_get(&ws);
+    LOG_INF("Boot: first sample %lld ms, network ready %lld ms, "
+            "first publish %lld ms",
+            (long long)first_sample_ms,
+            (long long)(ws.start_ms + ws.first_ready_ms),
+            (long long)first_publish_ms);
+}
+
+// Run one new sample through the aggregation stage. Reports go to the
+// retained backlog first so nothing is lost while the broker is unreachable.
+static void process_sample(const struct sensor_snapshot *snap)
+{
+    struct agg_summary summary;
+    uint32_t events = aggregator_feed(snap);
+
+    if (first_sample_ms < 0) {
+        first_sample_ms = snap->timestamp_ms;
+    }
+
+    if (events & (AGG_EVT_CHANGE | AGG_EVT_HEARTBEAT)) {
+        // Store wall clock time, uptime restarts if the backlog outlives a reset
+        const struct telemetry_record rec = {
+            .timestamp_ms = timestamp_from_uptime(snap->timestamp_ms),
+            .temperature = snap->temperature,
+            .humidity = snap->humidity,
+        };
+
+        duty_backlog_push(&rec);
+        aggregator_reported(snap);
+        LOG_INF("Queued DHT11 (%s) -> T=%d C, H=%d %%",
+                (events & AGG_EVT_CHANGE) ? "change" : "heartbeat",
+                snap->temperature, snap->humidity);
+    }
+
+    if (events & AGG_EVT_WINDOW) {
+        aggregator_take_summary(&summary);
+        if (mqtt_connected && publish_summary(&summary) >= 0) {
+            LOG_INF("Published summary of %u samples", summary.count);
+        }
+    }
+}
+
+// Send everything in the backlog, batching when several reports piled up
+static void flush_backlog(void)
 {
-    char ipv4[INET_ADDRSTRLEN];
-    char ipv6[INET6_ADDRSTRLEN];
-    struct sockaddr_in *sa;
-    struct sockaddr_in6 *sa6;
-    struct zsock_addrinfo *rp;
-
-    // Iterate through the results
-    for (rp = *results; rp != NULL; rp = rp->ai_next) {
-
-        // Print IPv4 address
-        if (rp->ai_addr->sa_family == AF_INET) {
-            sa = (struct sockaddr_in *)rp->ai_addr;
-            zsock_inet_ntop(AF_INET, &sa->sin_addr, ipv4, INET_ADDRSTRLEN);
-            printk("IPv4: %s\r\n", ipv4);
+    struct telemetry_record recs[PUBLISH_BATCH_MAX];
+    size_t n;
+    int sent;
+
+    while (mqtt_connected &&
+           (n = duty_backlog_peek(recs, ARRAY_SIZE(recs))) > 0) {
+        // Reports queued before the first SNTP sync still carry uptime
+        for (size_t i = 0; i < n; i++) {
+            recs[i].timestamp_ms = timestamp_resolve(recs[i].timestamp_ms);
+        }
+
+        sent = publish_records(recs, n);
+        if (sent <= 0) {
+            break;
         }
+        duty_backlog_drop(sent);
+        LOG_INF("Published %d report(s)", sent);
 
-        // Print IPv6 address
-        if (rp->ai_addr->sa_family == AF_INET6) {
-            sa6 = (struct sockaddr_in6 *)rp->ai_addr;
-            zsock_inet_ntop(AF_INET6, &sa6->sin6_addr, ipv6, INET6_ADDRSTRLEN);
-            printk("IPv6: %s\r\n", ipv6);
+        if (first_publish_ms < 0) {
+            first_publish_ms = k_uptime_get();
+            print_boot_timing();
         }
     }
 }
 
+#if DUTY_CYCLE_MODE
+static void print_duty_stats(void)
+{
+    struct duty_stats st;
+
+    duty_stats_get(&st);
+    LOG_INF("Duty: %u wakeups/h, awake %u.%u%%, radio on %u.%u%%",
+            st.wakeups_per_hour,
+            st.awake_permille / 10, st.awake_permille % 10,
+            st.radio_permille / 10, st.radio_permille % 10);
+}
+#endif
+
 
 int main(void)
 {
-    struct zsock_addrinfo hints;
-    struct zsock_addrinfo *res;
-    //char http_request[512];
-    //int sock;
-    //int len;
-    //uint32_t rx_total;
     int ret;
 
-    
-
-    // Initialize WiFi
-    wifi_init();
+    const struct aggregator_config agg_cfg = {
+        .temp_deadband = TEMP_DEADBAND,
+        .hum_deadband = HUM_DEADBAND,
+        .heartbeat_ms = HEARTBEAT_MS,
+        .window_ms = SUMMARY_WINDOW_MS,
+    };
+    const struct app_settings defaults = {
+        .sample_ms = DUTY_CYCLE_MODE ? DUTY_PERIOD_MS : 2000,
+        .window_ms = SUMMARY_WINDOW_MS,
+        .heartbeat_ms = HEARTBEAT_MS,
+        .temp_deadband = TEMP_DEADBAND,
+        .hum_deadband = HUM_DEADBAND,
+        .qos = MQTT_QOS_0_AT_MOST_ONCE,
+    };
 
-    // Connect to the WiFi network (blocking)
-    ret = wifi_connect(WIFI_SSID, WIFI_PSK);
+    // Associate and get an address in the background, sensing starts right
+    // away and reports wait in the backlog until the broker is reachable
+    ret = wifi_conn_start(WIFI_SSID, WIFI_PSK);
     if (ret < 0) {
         printk("Error (%d): WiFi connection failed\r\n", ret);
         return 0;
     }
 
-    // Wait to receive an IP address (blocking)
-    wifi_wait_for_ip_addr();
+    aggregator_init(&agg_cfg);
+    duty_init(DUTY_PERIOD_MS);
 
-    mqtt_init();
-    app_mqtt_connect(&client_ctx);
-
-    // Clear and set address info
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;              // IPv4
-    hints.ai_socktype = SOCK_STREAM;        // TCP socket
-
-    // Perform DNS lookup
-    printk("Performing DNS lookup...\r\n");
-    ret = zsock_getaddrinfo(HTTP_HOST, "80", &hints, &res);
-    if (ret != 0) {
-        printk("Error (%d): Could not perform DNS lookup\r\n", ret);
-        return 0;
-    }
-    else {
-        print_addrinfo(&res);
-        zsock_freeaddrinfo(res);
-    }
+    // Settings saved from the downlink override the defaults above
+    control_init(&defaults, apply_settings);
 
     if (dht11_init() != 0) {
         printk("Failed to initialize DHT11\n");
     } else {
         printk("DHT11 initialized successfully\n");
-        k_msleep(1000);
+#if !DUTY_CYCLE_MODE
+        // Sensor is read in the background, consumers only read the snapshot
+        sampler_start();
+#endif
     }
 
-    int temperature = 0;
-    int humidity = 0;
-    static uint32_t last_publish = 0;
+    struct sensor_snapshot snap;
+    bool net_up = false;
+
+#if DUTY_CYCLE_MODE
+    int64_t last_report = k_uptime_get();
+    bool sample_due = true;
+
+    while (1) {
+        duty_window_begin();
+        duty_radio_active(true);
+
+        // Sample, publish and service the broker in a single window
+        if (sample_due && sampler_sample_now() == 0 && sampler_get(&snap)) {
+            process_sample(&snap);
+        }
+
+        if (!net_up) {
+            net_up = network_start();
+        }
+
+        if (net_up) {
+            if (!mqtt_connected) {
+                connect_and_subscribe();
+            }
+            flush_backlog();
+
+            int64_t linger_end = k_uptime_get() + DUTY_LINGER_MS;
+            do {
+                mqtt_input(&client_ctx);
+                mqtt_live(&client_ctx);
+                k_msleep(50);
+            } while (k_uptime_get() < linger_end);
+
+            // Commands queued by the broker arrive during the linger time
+            control_poll(&client_ctx);
+        }
+
+        duty_radio_active(false);
+        duty_window_end();
+
+        if (k_uptime_get() - last_report >= DUTY_REPORT_MS) {
+            last_report = k_uptime_get();
+            print_duty_stats();
+        }
+
+        // An early wake for the network is not a sampling boundary
+        sample_due = duty_sleep();
+    }
+#else
+    uint32_t last_sample_count = 0;
+    static uint32_t last_reconnect = 0;
 
-    // Print the results of the DNS lookup
-    //mqtt_process_loop();
     while(1)
     {
+    // Feed each new sample once to the aggregation stage, it decides
+    // what is worth sending
+    if (sampler_get(&snap) && snap.sample_count != last_sample_count) {
+        last_sample_count = snap.sample_count;
+        process_sample(&snap);
+    }
 
+    if (!net_up) {
+        net_up = network_start();
+        last_reconnect = k_uptime_get_32();
+    }
+
+    if (net_up) {
         mqtt_input(&client_ctx);
         mqtt_live(&client_ctx);
         uint32_t now = k_uptime_get_32();
 
-    // Publish every 5 seconds if connected
-    if (mqtt_connected && (now - last_publish > 5000)) {
-        int temp, hum;
-                if (dht11_read(&temp, &hum) == 0) {
-            printk("DEBUG: DHT11 -> Temp=%d C, Hum=%d %%\n", temp, hum);
-            }
-
-        if (dht11_read(&temp, &hum) == 0) {
-            char payload[64];
-            snprintf(payload, sizeof(payload),
-                     "{\"temperature\": %d, \"humidity\": %d}", temp, hum);
-
-            app_mqtt_publish(&client_ctx, "esp32/sensor/dht11", payload);
-
-            LOG_INF("Published DHT11 -> T=%d C, H=%d %%", temp, hum);
-        } else {
-            LOG_ERR("Failed to read DHT11");
+        // Reconnect after the broker dropped us, the TLS session and the MQTT
+        // persistent session are both resumed so this is cheap
+        if (!mqtt_connected && (now - last_reconnect > MQTT_RECONNECT_MS)) {
+            last_reconnect = now;
+            connect_and_subscribe();
         }
 
-        last_publish = now;
+        control_poll(&client_ctx);
+        flush_backlog();
     }
 
     // Short sleep to avoid busy loop
     k_msleep(100); 
     }
+#endif
 }
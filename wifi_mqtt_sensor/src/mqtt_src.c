@@ -6,22 +6,226 @@
 #include <zephyr/types.h>
 #include <stdint.h>
 #include <arpa/inet.h>
-
-LOG_MODULE_REGISTER(mqtt_module, LOG_LEVEL_DBG);
-
-/* MQTT broker info */
+#include "mqtt_src.h"
+
+/* Apps that publish at high rate (bench) can build with a quieter level */
+#ifndef MQTT_SRC_LOG_LEVEL
+#define MQTT_SRC_LOG_LEVEL LOG_LEVEL_DBG
+#endif
+
+LOG_MODULE_REGISTER(mqtt_module, MQTT_SRC_LOG_LEVEL);
+
+/* MQTT broker info, can be overridden from the app CMakeLists.txt.
+ Without a fixed MQTT_CLIENT_ID every unit uses esp32_<hardware id>, the
+ broker keys the persistent session on it so it must be unique per unit */
+#ifndef MQTT_CLIENT_ID
+#include <zephyr/drivers/hwinfo.h>
+#ifndef MQTT_CLIENT_ID_PREFIX
+#define MQTT_CLIENT_ID_PREFIX "esp32_"
+#endif
+#endif
+
+#if defined(CONFIG_MQTT_LIB_TLS)
+/* TLS: build with -DEXTRA_CONF_FILE=overlay-tls.conf
+ The hostname must match the CN/SAN of the broker certificate */
+#include <zephyr/net/tls_credentials.h>
+#include "ca_cert.h"
+
+#ifndef MQTT_BROKER_HOSTNAME
+#define MQTT_BROKER_HOSTNAME "mosquitto.local"
+#endif
+#ifndef MQTT_BROKER_PORT
+#define MQTT_BROKER_PORT     8883
+#endif
+#define APP_CA_CERT_TAG      1
+
+static sec_tag_t sec_tag_list[] = { APP_CA_CERT_TAG };
+#else
+#ifndef MQTT_BROKER_HOSTNAME
 #define MQTT_BROKER_HOSTNAME "broker.emqx.io"
+#endif
+#ifndef MQTT_BROKER_PORT
 #define MQTT_BROKER_PORT     1883
-#define MQTT_CLIENT_ID       "esp32_test"
+#endif
+#endif
+
+/* How long app_mqtt_connect() waits for CONNACK */
+#define MQTT_CONNACK_TIMEOUT_MS 10000
+
+#if defined(CONFIG_MQTT_VERSION_5_0)
+/* CONNACK codes of a broker that does not speak the requested version,
+ 3.1.1 brokers answer a 5.0 CONNECT with their own return code */
+#define CONNACK_UNACCEPTABLE_PROTOCOL_3_1_1 0x01
+#define CONNACK_UNSUPPORTED_PROTOCOL_5_0    0x84
+
+/* Topic aliases we are willing to use, capped by the broker's maximum */
+#define MQTT_TOPIC_ALIAS_MAX 4
+
+/* How long the broker keeps our session after a disconnect. Under 5.0 the
+ default of 0 ends it at disconnect, whatever clean_session says, so queued
+ QoS 1 commands would be lost. 0xFFFFFFFF = never expires */
+#ifndef MQTT_SESSION_EXPIRY_S
+#define MQTT_SESSION_EXPIRY_S 0xFFFFFFFFU
+#endif
+#endif
 
 /* MQTT RX/TX buffers */
 static uint8_t rx_buffer[128];
 static uint8_t tx_buffer[128];
 
+/* Incoming PUBLISH payloads are copied here before the handler runs */
+static uint8_t rx_payload[128];
+
 struct mqtt_client client_ctx;
 static struct sockaddr_storage broker;
+static char client_id[32];
 
 bool mqtt_connected = false;
+/* Set when the broker resumed our persistent session, subscriptions are
+ still active and must not be sent again */
+bool mqtt_session_present = false;
+
+/* CONNACK outcome for app_mqtt_connect() */
+static bool connack_received;
+static int connack_result;
+/* The broker refused the protocol version, by CONNACK code or by closing
+ the connection before any CONNACK */
+static bool protocol_refused;
+
+/* Message ids for QoS 1, 0 is not a valid id */
+static uint16_t next_message_id = 1;
+
+static struct app_mqtt_stats stats;
+static app_mqtt_rx_cb_t rx_cb;
+static app_mqtt_puback_cb_t puback_cb;
+
+#if defined(CONFIG_MQTT_VERSION_5_0)
+/* Topic alias table, index + 1 is the alias sent to the broker.
+ Aliases only live for one network connection so it is cleared on CONNACK.
+ Only the pointer is kept, topics passed to publish must be static strings */
+static const char *alias_topics[MQTT_TOPIC_ALIAS_MAX];
+static uint16_t alias_count;
+static uint16_t alias_limit;
+
+/* Returns the alias to use for topic_str, 0 if none. *known is set when
+ the broker already has the mapping and the topic name can be omitted.
+ A new alias is only reserved here, topic_alias_commit() records it once
+ the PUBLISH that carries the topic name has gone out */
+static uint16_t topic_alias_get(const char *topic_str, bool *known)
+{
+    *known = false;
+
+    for (uint16_t i = 0; i < alias_count; i++) {
+        if (strcmp(alias_topics[i], topic_str) == 0) {
+            *known = true;
+            return i + 1;
+        }
+    }
+
+    if (alias_count < alias_limit) {
+        return alias_count + 1;
+    }
+
+    return 0;
+}
+
+static void topic_alias_commit(const char *topic_str, uint16_t alias)
+{
+    if (alias == alias_count + 1) {
+        alias_topics[alias_count++] = topic_str;
+    }
+}
+#endif
+
+
+/* Bytes needed for an MQTT variable byte integer */
+static size_t varint_len(size_t val)
+{
+    size_t n = 1;
+
+    while (val >= 128) {
+        val >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* Size of the PUBLISH packet as it goes on the wire (without TCP/TLS) */
+static size_t publish_wire_size(const struct mqtt_client *client,
+                                const struct mqtt_publish_param *param)
+{
+    size_t remaining = 2 + param->message.topic.topic.size +
+                       param->message.payload.len;
+
+    if (param->message.topic.qos > MQTT_QOS_0_AT_MOST_ONCE) {
+        remaining += 2;
+    }
+
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    if (client->protocol_version == MQTT_VERSION_5_0) {
+        const struct mqtt_utf8 *name = &param->message.prop.user_prop[0].name;
+        const struct mqtt_utf8 *value = &param->message.prop.user_prop[0].value;
+        size_t props = 0;
+
+        if (param->message.prop.topic_alias) {
+            props += 3;
+        }
+        if (param->message.prop.message_expiry_interval) {
+            props += 5;
+        }
+        if (name->size) {
+            props += 5 + name->size + value->size;
+        }
+        remaining += varint_len(props) + props;
+    }
+#else
+    ARG_UNUSED(client);
+#endif
+
+    return 1 + varint_len(remaining) + remaining;
+}
+
+
+/* Copy an incoming PUBLISH into rx_payload, ack it and hand it to the app */
+static void handle_publish(struct mqtt_client *const client,
+                           const struct mqtt_publish_param *pub)
+{
+    size_t len = pub->message.payload.len;
+    size_t keep = MIN(len, sizeof(rx_payload));
+    int rc;
+
+    rc = mqtt_readall_publish_payload(client, rx_payload, keep);
+    if (rc < 0) {
+        LOG_ERR("Failed to read payload [%d]", rc);
+        return;
+    }
+
+    /* Drain whatever did not fit so the stream stays in sync */
+    for (size_t left = len - keep; left > 0; ) {
+        uint8_t scratch[32];
+        size_t chunk = MIN(left, sizeof(scratch));
+
+        if (mqtt_readall_publish_payload(client, scratch, chunk) < 0) {
+            return;
+        }
+        left -= chunk;
+    }
+
+    if (pub->message.topic.qos == MQTT_QOS_1_AT_LEAST_ONCE) {
+        const struct mqtt_puback_param ack = {
+            .message_id = pub->message_id,
+        };
+        mqtt_publish_qos1_ack(client, &ack);
+    }
+
+    stats.rx_msgs++;
+    stats.rx_bytes += len;
+
+    if (rx_cb != NULL) {
+        rx_cb((const char *)pub->message.topic.topic.utf8,
+              pub->message.topic.topic.size, rx_payload, keep);
+    }
+}
 
 
 static void mqtt_event_handler(struct mqtt_client *const client,
@@ -29,16 +233,59 @@ static void mqtt_event_handler(struct mqtt_client *const client,
 {
     switch (evt->type) {
     case MQTT_EVT_CONNACK:
+        connack_received = true;
+        connack_result = evt->result;
         if (evt->result == 0) {
             mqtt_connected = true;
-            printk("MQTT connected (CONNACK)\n");
+            mqtt_session_present = evt->param.connack.session_present_flag;
+            printk("MQTT connected (CONNACK, session %s)\n",
+                   mqtt_session_present ? "resumed" : "new");
+#if defined(CONFIG_MQTT_VERSION_5_0)
+            alias_count = 0;
+            alias_limit = 0;
+            if (client->protocol_version == MQTT_VERSION_5_0 &&
+                evt->param.connack.prop.rx.has_topic_alias_maximum) {
+                alias_limit = MIN(evt->param.connack.prop.topic_alias_maximum,
+                                  MQTT_TOPIC_ALIAS_MAX);
+            }
+            printk("MQTT %s, %u topic aliases\n",
+                   client->protocol_version == MQTT_VERSION_5_0 ? "5.0" : "3.1.1",
+                   alias_limit);
+#endif
         } else {
             printk("MQTT CONNACK error: %d\n", evt->result);
+#if defined(CONFIG_MQTT_VERSION_5_0)
+            protocol_refused =
+                evt->result == CONNACK_UNACCEPTABLE_PROTOCOL_3_1_1 ||
+                evt->result == CONNACK_UNSUPPORTED_PROTOCOL_5_0;
+#endif
         }
         break;
 
+    case MQTT_EVT_DISCONNECT:
+        if (!connack_received) {
+            protocol_refused = true;
+        }
+        connack_received = true;
+        connack_result = evt->result ? evt->result : -ECONNRESET;
+        mqtt_connected = false;
+        printk("MQTT disconnected: %d\n", evt->result);
+        break;
+
     case MQTT_EVT_PUBACK:
-        printk("PUBACK received\n");
+        stats.pubacks++;
+        LOG_DBG("PUBACK %u", evt->param.puback.message_id);
+        if (puback_cb != NULL) {
+            puback_cb(evt->param.puback.message_id);
+        }
+        break;
+
+    case MQTT_EVT_PUBLISH:
+        handle_publish(client, &evt->param.publish);
+        break;
+
+    case MQTT_EVT_SUBACK:
+        LOG_INF("SUBACK %u", evt->param.suback.message_id);
         break;
 
     default:
@@ -47,8 +294,37 @@ static void mqtt_event_handler(struct mqtt_client *const client,
 }
 
 
+const char *app_mqtt_client_id(void)
+{
+    if (client_id[0] != '\0') {
+        return client_id;
+    }
+
+#ifdef MQTT_CLIENT_ID
+    strncpy(client_id, MQTT_CLIENT_ID, sizeof(client_id) - 1);
+#else
+    /* ESP32: the factory MAC, 6 bytes */
+    uint8_t hwid[8];
+    ssize_t len = hwinfo_get_device_id(hwid, sizeof(hwid));
+
+    strcpy(client_id, MQTT_CLIENT_ID_PREFIX);
+    if (len > 0) {
+        bin2hex(hwid, len, &client_id[strlen(client_id)],
+                sizeof(client_id) - strlen(client_id));
+    } else {
+        LOG_ERR("No hardware id (%d), client id is not unique", (int)len);
+        strcat(client_id, "unknown");
+    }
+#endif
+
+    return client_id;
+}
+
+
 void mqtt_init(void)
 {
+    const char *id = app_mqtt_client_id();
+
     mqtt_client_init(&client_ctx);
     memset(&broker, 0, sizeof(broker));
 
@@ -56,16 +332,54 @@ void mqtt_init(void)
     client_ctx.broker = &broker;
     client_ctx.evt_cb = mqtt_event_handler;
 
-    client_ctx.client_id.utf8 = (uint8_t *)MQTT_CLIENT_ID;
-    client_ctx.client_id.size = strlen(MQTT_CLIENT_ID);
+    client_ctx.client_id.utf8 = (uint8_t *)id;
+    client_ctx.client_id.size = strlen(id);
     client_ctx.user_name = NULL;
     client_ctx.password = NULL;
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    /* Try 5.0 first, app_mqtt_connect() drops to 3.1.1 if the broker refuses */
+    client_ctx.protocol_version = MQTT_VERSION_5_0;
+#else
     client_ctx.protocol_version = MQTT_VERSION_3_1_1;
+#endif
 
     client_ctx.keepalive = 60;
 
+    /* Persistent session: the broker keeps our subscriptions and queued
+     QoS 1 messages across reconnects, keyed by the per-unit client id */
+    client_ctx.clean_session = 0;
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    /* Ignored by a 3.1.1 CONNECT after the fallback */
+    client_ctx.prop.session_expiry_interval = MQTT_SESSION_EXPIRY_S;
+#endif
+
+#if defined(CONFIG_MQTT_LIB_TLS)
+    struct mqtt_sec_config *tls_config = &client_ctx.transport.tls.config;
+
+    /* Credentials stay registered across reconnects, only add them once */
+    int err = tls_credential_add(APP_CA_CERT_TAG, TLS_CREDENTIAL_CA_CERTIFICATE,
+                                 ca_cert, sizeof(ca_cert));
+    if (err < 0 && err != -EEXIST) {
+        LOG_ERR("Failed to register CA certificate: %d", err);
+    }
+
+    client_ctx.transport.type = MQTT_TRANSPORT_SECURE;
+    client_ctx.transport.tls.sock = -1;
+
+    tls_config->peer_verify = TLS_PEER_VERIFY_REQUIRED;
+    tls_config->cipher_list = NULL;
+    tls_config->sec_tag_list = sec_tag_list;
+    tls_config->sec_tag_count = ARRAY_SIZE(sec_tag_list);
+    tls_config->hostname = MQTT_BROKER_HOSTNAME;
+    tls_config->cert_nocopy = TLS_CERT_NOCOPY_OPTIONAL;
+    /* Keep the negotiated session in the socket layer cache so a
+     reconnect to the same broker does an abbreviated handshake instead of
+     a full key exchange */
+    tls_config->session_cache = TLS_SESSION_CACHE_ENABLED;
+#else
     client_ctx.transport.type = MQTT_TRANSPORT_NON_SECURE;
     client_ctx.transport.tcp.sock = -1;
+#endif
 
     client_ctx.rx_buf = rx_buffer;
     client_ctx.rx_buf_size = sizeof(rx_buffer);
@@ -93,56 +407,210 @@ void mqtt_init(void)
 }
 
 
-void app_mqtt_connect(struct mqtt_client *client_ctx)
+static int connect_once(struct mqtt_client *client_ctx)
 {
+    int64_t start = k_uptime_get();
+
+    connack_received = false;
+    protocol_refused = false;
+
     int rc = mqtt_connect(client_ctx);
     if (rc != 0) {
         LOG_ERR("MQTT Connect failed [%d]", rc);
-        return;
+        return rc;
     }
 
     LOG_INF("Waiting for CONNACK...");
 
     /* Pump MQTT state machine until CONNACK arrives */
-    while (!mqtt_connected) {
+    while (!connack_received) {
         mqtt_input(client_ctx);
         mqtt_live(client_ctx);
+
+        if (k_uptime_get() - start > MQTT_CONNACK_TIMEOUT_MS) {
+            LOG_ERR("No CONNACK, giving up");
+            mqtt_abort(client_ctx);
+            /* Our own abort is not a refusal by the broker */
+            protocol_refused = false;
+            return -ETIMEDOUT;
+        }
         k_msleep(50);
     }
 
-    LOG_INF("MQTT Connected and ready to publish!");
+    if (!mqtt_connected) {
+        /* Refused or dropped by the broker */
+        mqtt_abort(client_ctx);
+        return connack_result ? connack_result : -ECONNREFUSED;
+    }
+
+    LOG_INF("MQTT Connected in %lld ms and ready to publish!",
+            (long long)(k_uptime_get() - start));
+    return 0;
+}
+
+
+int app_mqtt_connect(struct mqtt_client *client_ctx)
+{
+    int rc = connect_once(client_ctx);
+
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    /* A 3.1.1 only broker rejects the 5.0 CONNECT or just closes the
+     socket, fall back and stay on 3.1.1 for the rest of this boot. DNS,
+     TCP and CONNACK timeout errors say nothing about the broker's version,
+     those keep 5.0 for the next attempt */
+    if (rc != 0 && protocol_refused &&
+        client_ctx->protocol_version == MQTT_VERSION_5_0) {
+        LOG_WRN("MQTT 5.0 refused (%d), falling back to 3.1.1", rc);
+        client_ctx->protocol_version = MQTT_VERSION_3_1_1;
+        rc = connect_once(client_ctx);
+    }
+#endif
+
+    return rc;
 }
 
 
 int app_mqtt_publish(struct mqtt_client *client_ctx, const char *topic_str, const char *payload)
 {
-    struct mqtt_publish_param param;
+    return app_mqtt_publish_raw(client_ctx, topic_str,
+                                (const uint8_t *)payload, strlen(payload));
+}
+
+
+int app_mqtt_publish_raw(struct mqtt_client *client_ctx, const char *topic_str,
+                         const uint8_t *data, size_t len)
+{
+    return app_mqtt_publish_ex(client_ctx, topic_str, data, len, NULL);
+}
+
+
+int app_mqtt_publish_ex(struct mqtt_client *client_ctx, const char *topic_str,
+                        const uint8_t *data, size_t len,
+                        const struct app_mqtt_meta *meta)
+{
+    struct mqtt_publish_param param = {0};
     struct mqtt_topic topic = {
         .topic = {
             .utf8 = (uint8_t *)topic_str,
             .size = strlen(topic_str)
         },
-        .qos = MQTT_QOS_0_AT_MOST_ONCE
+        .qos = meta != NULL ? meta->qos : MQTT_QOS_0_AT_MOST_ONCE
     };
 
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    uint16_t alias = 0;
+    bool known = false;
+
+    if (client_ctx->protocol_version == MQTT_VERSION_5_0) {
+        alias = topic_alias_get(topic_str, &known);
+
+        /* Once the broker knows the alias the topic name is sent empty */
+        param.message.prop.topic_alias = alias;
+        if (known) {
+            topic.topic.size = 0;
+        }
+
+        if (meta != NULL) {
+            if (meta->expiry_s) {
+                param.message.prop.message_expiry_interval = meta->expiry_s;
+            }
+            if (meta->prop_name != NULL && meta->prop_value != NULL) {
+                param.message.prop.user_prop[0].name.utf8 = (uint8_t *)meta->prop_name;
+                param.message.prop.user_prop[0].name.size = strlen(meta->prop_name);
+                param.message.prop.user_prop[0].value.utf8 = (uint8_t *)meta->prop_value;
+                param.message.prop.user_prop[0].value.size = strlen(meta->prop_value);
+            }
+        }
+    }
+#else
+    ARG_UNUSED(meta);
+#endif
+
     param.message.topic = topic;
-    param.message.payload.data = (uint8_t *)payload;
-    param.message.payload.len = strlen(payload);
-    param.message_id = k_uptime_get_32();
+    param.message.payload.data = (uint8_t *)data;
+    param.message.payload.len = len;
+    param.message_id = next_message_id++;
+    if (next_message_id == 0) {
+        next_message_id = 1;
+    }
     param.dup_flag = 0;
     param.retain_flag = 0;
 
     int rc = mqtt_publish(client_ctx, &param);
     if (rc != 0) {
         LOG_ERR("MQTT Publish failed [%d]", rc);
+        return rc;
+    }
+
+#if defined(CONFIG_MQTT_VERSION_5_0)
+    /* The broker only learns the mapping from a PUBLISH that arrived */
+    if (alias != 0 && !known) {
+        topic_alias_commit(topic_str, alias);
+    }
+#endif
+
+    stats.tx_msgs++;
+    stats.tx_bytes += publish_wire_size(client_ctx, &param);
+    LOG_INF("Published message to topic '%s'", topic_str);
+
+    return param.message_id;
+}
+
+
+int app_mqtt_subscribe(struct mqtt_client *client_ctx, const char *topic_str,
+                       uint8_t qos)
+{
+    struct mqtt_topic topic = {
+        .topic = {
+            .utf8 = (uint8_t *)topic_str,
+            .size = strlen(topic_str)
+        },
+        .qos = qos
+    };
+    const struct mqtt_subscription_list list = {
+        .list = &topic,
+        .list_count = 1,
+        .message_id = next_message_id++,
+    };
+
+    if (next_message_id == 0) {
+        next_message_id = 1;
+    }
+
+    int rc = mqtt_subscribe(client_ctx, &list);
+    if (rc != 0) {
+        LOG_ERR("MQTT Subscribe to '%s' failed [%d]", topic_str, rc);
     } else {
-        LOG_INF("Published message to topic '%s'",
-                param.message.topic.topic.utf8);
+        LOG_INF("Subscribed to '%s'", topic_str);
     }
 
     return rc;
 }
 
+
+void app_mqtt_set_rx_cb(app_mqtt_rx_cb_t cb)
+{
+    rx_cb = cb;
+}
+
+
+void app_mqtt_set_puback_cb(app_mqtt_puback_cb_t cb)
+{
+    puback_cb = cb;
+}
+
+
+void app_mqtt_stats_get(struct app_mqtt_stats *out)
+{
+    *out = stats;
+}
+
+
+void app_mqtt_stats_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
 void mqtt_process_loop(void)
 {
     static uint32_t last_publish = 0;
@@ -1,12 +1,54 @@
 #ifndef MQTT_SRC_H
 #define MQTT_SRC_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
 
-void app_mqtt_connect(struct mqtt_client *client_ctx);
+/* Optional per-message metadata, carried as MQTT 5.0 properties instead of
+ in the payload. Only the QoS is used when connected with 3.1.1 */
+struct app_mqtt_meta {
+    uint8_t qos;                // enum mqtt_qos, 0 or 1
+    uint32_t expiry_s;          // Message expiry interval, 0 = never
+    const char *prop_name;      // One user property, NULL = none
+    const char *prop_value;
+};
+
+/* Traffic counters, bytes are MQTT packet sizes without TCP/TLS overhead */
+struct app_mqtt_stats {
+    uint32_t tx_msgs;
+    uint32_t tx_bytes;
+    uint32_t rx_msgs;
+    uint32_t rx_bytes;
+    uint32_t pubacks;
+};
+
+/* Called from mqtt_input() for every message on a subscribed topic */
+typedef void (*app_mqtt_rx_cb_t)(const char *topic, size_t topic_len,
+                                 const uint8_t *payload, size_t len);
+/* Called from mqtt_input() when a QoS 1 publish is acknowledged */
+typedef void (*app_mqtt_puback_cb_t)(uint16_t message_id);
+
+/* Client id, fixed per unit. Available before mqtt_init() */
+const char *app_mqtt_client_id(void);
+int app_mqtt_connect(struct mqtt_client *client_ctx);
+/* Publish functions return the message id (> 0) or a negative error */
 int app_mqtt_publish(struct mqtt_client *client_ctx,
                      const char *topic_str,
                      const char *payload);
-int wifi_connect(char *ssid, char *psk);
+int app_mqtt_publish_raw(struct mqtt_client *client_ctx,
+                         const char *topic_str,
+                         const uint8_t *data, size_t len);
+int app_mqtt_publish_ex(struct mqtt_client *client_ctx,
+                        const char *topic_str,
+                        const uint8_t *data, size_t len,
+                        const struct app_mqtt_meta *meta);
+int app_mqtt_subscribe(struct mqtt_client *client_ctx,
+                       const char *topic_str, uint8_t qos);
+void app_mqtt_set_rx_cb(app_mqtt_rx_cb_t cb);
+void app_mqtt_set_puback_cb(app_mqtt_puback_cb_t cb);
+void app_mqtt_stats_get(struct app_mqtt_stats *out);
+void app_mqtt_stats_reset(void);
 void mqtt_init(void);
 void mqtt_process_loop(void);
 #endif
\ No newline at end of file
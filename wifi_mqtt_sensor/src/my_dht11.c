@@ -11,6 +11,151 @@
 
 LOG_MODULE_REGISTER(dht11_sensor);
 
+// Decoding mode: 1 = timestamp the sensor's edges from GPIO interrupts and
+// decode the bits afterwards, 0 = the aosong,dht driver, which bit-bangs the
+// whole ~4 ms transfer with interrupts locked and starves the WiFi stack.
+// Both drive the same pin, so the driver (CONFIG_DHT) selects mode 0.
+#ifndef DHT11_IRQ_DECODE
+#define DHT11_IRQ_DECODE !IS_ENABLED(CONFIG_DHT)
+#endif
+
+#if DHT11_IRQ_DECODE
+
+/* DHT11 frame after the host releases the line:
+   80 us low + 80 us high response, then 40 bits of 50 us low followed by
+   26-28 us high (0) or 70 us high (1), then 50 us low. Only falling edges
+   are captured, the time between two of them is 50 us + the high time. */
+#define DHT_EDGES 42                // Response, 40 bits, end of frame
+#define DHT_START_LOW_MS 20         // Host start signal, at least 18 ms
+#define DHT_FRAME_TIMEOUT_MS 10     // A full frame takes ~4.2 ms
+#define DHT_RESPONSE_MIN_US 120     // Response low + high, nominally 160 us
+#define DHT_RESPONSE_MAX_US 220
+#define DHT_BIT_MIN_US 60           // Falling to falling, ~77 us for a 0
+#define DHT_BIT_MAX_US 160          // and ~120 us for a 1
+#define DHT_BIT_THRESHOLD_US 100
+
+static const struct gpio_dt_spec dio = GPIO_DT_SPEC_GET(DT_NODELABEL(dht11), dio_gpios);
+static struct gpio_callback dio_cb;
+
+// Filled by the ISR, read by dht11_read() once the frame is complete
+static uint32_t edge_cyc[DHT_EDGES];
+static volatile uint32_t edge_count;
+static K_SEM_DEFINE(frame_done, 0, 1);
+
+// Only records the time, the interrupt is locked out for microseconds
+static void dio_edge_isr(const struct device *port, struct gpio_callback *cb,
+                         uint32_t pins)
+{
+    uint32_t n = edge_count;
+
+    if (n < DHT_EDGES) {
+        edge_cyc[n] = k_cycle_get_32();
+        edge_count = n + 1;
+        if (n + 1 == DHT_EDGES) {
+            k_sem_give(&frame_done);
+        }
+    }
+}
+
+static uint32_t edge_us(int i)
+{
+    return k_cyc_to_us_near32(edge_cyc[i + 1] - edge_cyc[i]);
+}
+
+// Turn the captured edge times into the 5 data bytes and check them
+static int dht11_decode(uint8_t data[5])
+{
+    uint32_t response_us = edge_us(0);
+
+    if (response_us < DHT_RESPONSE_MIN_US || response_us > DHT_RESPONSE_MAX_US) {
+        LOG_DBG("Bad response (%u us)", response_us);
+        return -EIO;
+    }
+
+    memset(data, 0, 5);
+    for (int i = 0; i < 40; i++) {
+        uint32_t us = edge_us(i + 1);
+
+        // A glitch or a missed edge shows up as an impossible bit time
+        if (us < DHT_BIT_MIN_US || us > DHT_BIT_MAX_US) {
+            LOG_DBG("Bad bit %d (%u us)", i, us);
+            return -EIO;
+        }
+        data[i / 8] = (data[i / 8] << 1) | (us > DHT_BIT_THRESHOLD_US);
+    }
+
+    if (((data[0] + data[1] + data[2] + data[3]) & 0xff) != data[4]) {
+        return -EBADMSG;
+    }
+    return 0;
+}
+
+int dht11_init(void)
+{
+    int ret;
+
+    if (!gpio_is_ready_dt(&dio)) {
+        LOG_ERR("Device not ready");
+        return -ENODEV;
+    }
+
+    // Idle: released, the module's pull-up holds the line high
+    ret = gpio_pin_configure_dt(&dio, GPIO_INPUT);
+    if (ret) {
+        return ret;
+    }
+
+    gpio_init_callback(&dio_cb, dio_edge_isr, BIT(dio.pin));
+    ret = gpio_add_callback_dt(&dio, &dio_cb);
+    if (ret) {
+        return ret;
+    }
+
+    LOG_INF("DHT11 initialized successfully (interrupt timed)");
+    return 0;
+}
+
+int dht11_read(int *temp, int *humidity)
+{
+    uint8_t data[5];
+    int ret;
+
+    // Start signal, the thread sleeps instead of spinning
+    gpio_pin_configure_dt(&dio, GPIO_OUTPUT_LOW);
+    k_msleep(DHT_START_LOW_MS);
+
+    edge_count = 0;
+    k_sem_reset(&frame_done);
+
+    // Release the line and capture the sensor's answer. The response starts
+    // 20-40 us later, well after these two calls return.
+    gpio_pin_configure_dt(&dio, GPIO_INPUT);
+    gpio_pin_interrupt_configure_dt(&dio, GPIO_INT_EDGE_FALLING);
+
+    ret = k_sem_take(&frame_done, K_MSEC(DHT_FRAME_TIMEOUT_MS));
+    gpio_pin_interrupt_configure_dt(&dio, GPIO_INT_DISABLE);
+    if (ret) {
+        LOG_ERR("Sample fetch error: timeout (%u edges)", edge_count);
+        return -ETIMEDOUT;
+    }
+
+    ret = dht11_decode(data);
+    if (ret) {
+        LOG_ERR("Sample fetch error: %d", ret);
+        return ret;
+    }
+
+    // Integer parts, bit 7 of the temperature decimal is the sign on newer parts
+    *humidity = data[0];
+    *temp = (data[3] & 0x80) ? -(int)data[2] : data[2];
+
+    LOG_DBG("Read DHT11 -> Temp=%d C, Hum=%d %%", *temp, *humidity);
+
+    return 0;
+}
+
+#else
+
 static const struct device *const dht =DEVICE_DT_GET(DT_NODELABEL(dht11));
 
 int dht11_to_int(const struct sensor_value *v)
@@ -20,7 +165,7 @@ int dht11_to_int(const struct sensor_value *v)
 
 int dht11_init(void)
 {
-    
+
     if (!device_is_ready(dht)) {
         LOG_ERR("Device not ready");
         return -ENODEV;
@@ -58,4 +203,6 @@ int dht11_read(int *temp, int *humidity)
     LOG_DBG("Read DHT11 -> Temp=%d C, Hum=%d %%", *temp, *humidity);
 
     return 0;
-}
\ No newline at end of file
+}
+
+#endif // DHT11_IRQ_DECODE
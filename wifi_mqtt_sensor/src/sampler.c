@@ -0,0 +1,106 @@
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "my_dht11.h"
+#include "sampler.h"
+#include "seqlock.h"
+
+LOG_MODULE_REGISTER(sampler);
+
+// DHT11 needs at least 1 s between conversions, leave some margin
+#define SAMPLER_PERIOD_MS 2000
+#define SAMPLER_MIN_PERIOD_MS 1000
+
+static uint32_t period_ms = SAMPLER_PERIOD_MS;
+
+// Number of failed reads in a row before the snapshot is marked stale
+#define SAMPLER_STALE_AFTER 2
+
+#define SAMPLER_THREAD_STACK_SIZE 1024
+#define SAMPLER_THREAD_PRIORITY 6
+
+K_THREAD_STACK_DEFINE(sampler_stack, SAMPLER_THREAD_STACK_SIZE);
+static struct k_thread sampler_thread;
+
+// Snapshot shared with every consumer, only the sampler thread writes it
+static struct seqlock snap_lock = SEQLOCK_INIT;
+static struct sensor_snapshot snap_data;
+
+static void snapshot_store(const struct sensor_snapshot *snap)
+{
+    seqlock_write(&snap_lock, &snap_data, snap, sizeof(snap_data));
+}
+
+bool sampler_get(struct sensor_snapshot *snap)
+{
+    seqlock_read(&snap_lock, snap, &snap_data, sizeof(*snap));
+
+    return snap->quality != SAMPLE_QUALITY_NONE;
+}
+
+// Sampler state, owned by whichever thread takes the samples
+static struct sensor_snapshot local;
+static int failures;
+
+// Read the sensor once and publish the result to the snapshot
+static int sample_once(void)
+{
+    int temp, hum;
+
+    if (dht11_read(&temp, &hum) == 0) {
+        local.temperature = temp;
+        local.humidity = hum;
+        local.timestamp_ms = k_uptime_get();
+        local.sample_count++;
+        local.quality = SAMPLE_QUALITY_GOOD;
+        failures = 0;
+        snapshot_store(&local);
+        return 0;
+    }
+
+    if (local.quality != SAMPLE_QUALITY_NONE &&
+        ++failures == SAMPLER_STALE_AFTER) {
+        // Keep the last good value but let consumers know it is old
+        local.quality = SAMPLE_QUALITY_STALE;
+        snapshot_store(&local);
+    }
+    return -EIO;
+}
+
+// Sampler thread start function
+static void sampler_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    while (1) {
+        sample_once();
+        k_msleep(period_ms);
+    }
+}
+
+void sampler_set_period(uint32_t ms)
+{
+    // Takes effect after the current sleep
+    period_ms = MAX(ms, SAMPLER_MIN_PERIOD_MS);
+}
+
+int sampler_sample_now(void)
+{
+    return sample_once();
+}
+
+int sampler_start(void)
+{
+    k_thread_create(&sampler_thread,
+                    sampler_stack,
+                    K_THREAD_STACK_SIZEOF(sampler_stack),
+                    sampler_thread_start,
+                    NULL, NULL, NULL,
+                    SAMPLER_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&sampler_thread, "sampler");
+
+    LOG_INF("Sampler started (%u ms period)", period_ms);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Quality of the value held in the snapshot
+enum sample_quality {
+    SAMPLE_QUALITY_NONE = 0,    // No successful read since boot
+    SAMPLE_QUALITY_GOOD,        // Latest read succeeded
+    SAMPLE_QUALITY_STALE,       // Latest read(s) failed, holding the last good value
+};
+
+// Last good sensor reading, published by the sampler thread
+struct sensor_snapshot {
+    int temperature;            // Degrees C
+    int humidity;               // Percent RH
+    int64_t timestamp_ms;       // k_uptime_get() when the value was read
+    uint32_t sample_count;      // Number of good reads so far
+    uint8_t quality;            // enum sample_quality
+};
+
+// Start the background sampling thread (sensor must already be initialized)
+int sampler_start(void);
+
+// Change the background sampling period (clamped to the DHT11 minimum)
+void sampler_set_period(uint32_t ms);
+
+// Take one sample from the calling thread, for duty-cycled operation where
+// sampling is aligned with the wake window. Do not mix with sampler_start().
+int sampler_sample_now(void);
+
+// Copy the latest snapshot without blocking or touching the sensor bus.
+// Returns false if no good sample has been taken yet.
+bool sampler_get(struct sensor_snapshot *snap);
+
+#endif // SAMPLER_H
@@ -0,0 +1,56 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+/* Single writer sequence lock
+ The writer makes the sequence odd while it updates the data and even again
+ once done, readers retry if they saw an odd sequence or the sequence changed
+ under them. The update runs with the scheduler locked, so a higher priority
+ reader cannot preempt the writer halfway and spin on an odd sequence that
+ never turns even. Only one thread may write a given seqlock, and the data
+ should be small: other threads do not run during the copy.*/
+struct seqlock {
+    atomic_t seq;
+};
+
+#define SEQLOCK_INIT { .seq = ATOMIC_INIT(0) }
+
+static inline void seqlock_write(struct seqlock *sl, void *dst,
+                                 const void *src, size_t size)
+{
+    k_sched_lock();
+    atomic_inc(&sl->seq);           // odd: write in progress
+    barrier_dmem_fence_full();
+    memcpy(dst, src, size);
+    barrier_dmem_fence_full();
+    atomic_inc(&sl->seq);           // even: data consistent
+    k_sched_unlock();
+}
+
+static inline void seqlock_read(struct seqlock *sl, void *dst,
+                                const void *src, size_t size)
+{
+    atomic_val_t start;
+
+    do {
+        start = atomic_get(&sl->seq);
+        if (start & 1) {
+            // Writer is in the middle of an update, only possible when it
+            // was interrupted. Sleep rather than yield, k_yield() does not
+            // give the CPU to a lower priority writer.
+            if (!k_is_in_isr()) {
+                k_sleep(K_TICKS(1));
+            }
+            continue;
+        }
+        barrier_dmem_fence_full();
+        memcpy(dst, src, size);
+        barrier_dmem_fence_full();
+    } while ((start & 1) || atomic_get(&sl->seq) != start);
+}
+
+#endif // SEQLOCK_H
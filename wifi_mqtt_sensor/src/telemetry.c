@@ -0,0 +1,98 @@
+#include <errno.h>
+
+#include "cbor_enc.h"
+#include "telemetry.h"
+
+int telemetry_encode_sample(uint8_t *buf, size_t size,
+                            const struct sensor_snapshot *snap)
+{
+    struct cbor_writer w;
+
+    cbor_writer_init(&w, buf, size);
+    cbor_put_map(&w, 4);
+    cbor_put_uint(&w, TELEM_KEY_TEMP);
+    cbor_put_int(&w, snap->temperature);
+    cbor_put_uint(&w, TELEM_KEY_HUM);
+    cbor_put_int(&w, snap->humidity);
+    cbor_put_uint(&w, TELEM_KEY_TS);
+    cbor_put_int(&w, snap->timestamp_ms);
+    cbor_put_uint(&w, TELEM_KEY_QUALITY);
+    cbor_put_uint(&w, snap->quality);
+
+    return cbor_writer_finish(&w);
+}
+
+int telemetry_encode_batch(uint8_t *buf, size_t size,
+                           const struct telemetry_record *recs, size_t count)
+{
+    struct cbor_writer w;
+    int64_t base = count ? recs[0].timestamp_ms : 0;
+
+    cbor_writer_init(&w, buf, size);
+    cbor_put_map(&w, 2);
+    cbor_put_uint(&w, TELEM_KEY_TS);
+    cbor_put_int(&w, base);
+    cbor_put_uint(&w, TELEM_KEY_RECORDS);
+    cbor_put_array(&w, count);
+
+    for (size_t i = 0; i < count; i++) {
+        cbor_put_array(&w, 3);
+        cbor_put_int(&w, recs[i].timestamp_ms - base);
+        cbor_put_int(&w, recs[i].temperature);
+        cbor_put_int(&w, recs[i].humidity);
+    }
+
+    return cbor_writer_finish(&w);
+}
+
+int telemetry_encode_series(uint8_t *buf, size_t size,
+                            enum telemetry_key channel,
+                            int64_t start_ms, uint32_t interval_ms,
+                            const int16_t *values, size_t count)
+{
+    struct cbor_writer w;
+
+    cbor_writer_init(&w, buf, size);
+    cbor_put_map(&w, 3);
+    cbor_put_uint(&w, TELEM_KEY_TS);
+    cbor_put_int(&w, start_ms);
+    cbor_put_uint(&w, TELEM_KEY_INTERVAL);
+    cbor_put_uint(&w, interval_ms);
+    cbor_put_uint(&w, channel);
+    cbor_put_array(&w, count);
+
+    for (size_t i = 0; i < count; i++) {
+        cbor_put_int(&w, values[i]);
+    }
+
+    return cbor_writer_finish(&w);
+}
+
+static void put_stats(struct cbor_writer *w, const struct agg_stats *st)
+{
+    cbor_put_array(w, 3);
+    cbor_put_int(w, st->min);
+    cbor_put_int(w, st->max);
+    cbor_put_int(w, st->mean_x10);
+}
+
+int telemetry_encode_summary(uint8_t *buf, size_t size,
+                             const struct agg_summary *sum)
+{
+    struct cbor_writer w;
+
+    cbor_writer_init(&w, buf, size);
+    cbor_put_map(&w, 5);
+    cbor_put_uint(&w, TELEM_KEY_TS);
+    cbor_put_int(&w, sum->start_ms);
+    cbor_put_uint(&w, TELEM_KEY_DURATION);
+    cbor_put_uint(&w, sum->duration_ms);
+    cbor_put_uint(&w, TELEM_KEY_COUNT);
+    cbor_put_uint(&w, sum->count);
+    cbor_put_uint(&w, TELEM_KEY_TEMP);
+    put_stats(&w, &sum->temp);
+    cbor_put_uint(&w, TELEM_KEY_HUM);
+    put_stats(&w, &sum->hum);
+
+    return cbor_writer_finish(&w);
+}
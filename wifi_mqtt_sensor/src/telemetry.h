@@ -0,0 +1,51 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sampler.h"
+#include "aggregator.h"
+
+/* CBOR telemetry schema
+ Every message is a CBOR map with small integer keys instead of JSON names.
+ Timestamps are UTC milliseconds once SNTP has synced (uptime milliseconds
+ before that, easy to tell apart by magnitude). Batch and series entries
+ carry a delta from the base timestamp so each entry stays at 1-3 bytes per
+ field. Callers convert uptime with timestamp_from_uptime() before encoding.
+
+   sample:  {1: temp, 2: hum, 3: ts, 4: quality}
+   batch:   {3: base_ts, 5: [[dt, temp, hum], ...]}
+   series:  {3: base_ts, 6: interval, <channel key>: [v0, v1, ...]}
+   summary: {3: start_ts, 7: duration, 8: count,
+             1: [min, max, mean_x10], 2: [min, max, mean_x10]}*/
+enum telemetry_key {
+    TELEM_KEY_TEMP = 1,
+    TELEM_KEY_HUM = 2,
+    TELEM_KEY_TS = 3,
+    TELEM_KEY_QUALITY = 4,
+    TELEM_KEY_RECORDS = 5,
+    TELEM_KEY_INTERVAL = 6,
+    TELEM_KEY_DURATION = 7,
+    TELEM_KEY_COUNT = 8,
+};
+
+// One entry of a batch message
+struct telemetry_record {
+    int64_t timestamp_ms;
+    int16_t temperature;
+    int16_t humidity;
+};
+
+// All encoders return the payload length or -ENOMEM if it does not fit
+int telemetry_encode_sample(uint8_t *buf, size_t size,
+                            const struct sensor_snapshot *snap);
+int telemetry_encode_batch(uint8_t *buf, size_t size,
+                           const struct telemetry_record *recs, size_t count);
+int telemetry_encode_series(uint8_t *buf, size_t size,
+                            enum telemetry_key channel,
+                            int64_t start_ms, uint32_t interval_ms,
+                            const int16_t *values, size_t count);
+int telemetry_encode_summary(uint8_t *buf, size_t size,
+                             const struct agg_summary *sum);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,163 @@
+#include <zephyr/kernel.h>
+#include <zephyr/net/sntp.h>
+#include <zephyr/logging/log.h>
+
+#include "seqlock.h"
+#include "timesync.h"
+
+LOG_MODULE_REGISTER(timesync);
+
+#define SNTP_SERVER "pool.ntp.org"
+#define SNTP_TIMEOUT_MS 3000
+
+// Resync quickly until the first success, then rarely
+#define TIMESYNC_RETRY_MS (10 * 1000)
+#define TIMESYNC_PERIOD_MS (60 * 60 * 1000)
+
+// Crystal drift above this is treated as a bad measurement
+#define TIMESYNC_MAX_DRIFT_PPB 500000
+
+// Smallest value that can be a UTC timestamp (2001-09-09)
+#define TIMESYNC_UTC_MIN_MS 1000000000000LL
+
+#define TIMESYNC_THREAD_STACK_SIZE 2048
+#define TIMESYNC_THREAD_PRIORITY 10
+
+K_THREAD_STACK_DEFINE(timesync_stack, TIMESYNC_THREAD_STACK_SIZE);
+static struct k_thread timesync_thread;
+
+/* Clock model: utc = uptime + offset + (uptime - ref) * drift
+ Written by the sync thread only (priority 10), read through the seqlock by
+ timestamp_from_uptime() from higher priority threads such as main */
+struct clock_model {
+    int64_t offset_ms;          // utc - uptime at ref_uptime_ms
+    int64_t ref_uptime_ms;      // uptime of the last sync
+    int32_t drift_ppb;          // Local clock error, parts per billion
+    bool synced;
+};
+
+static struct seqlock model_lock = SEQLOCK_INIT;
+static struct clock_model model;
+
+int64_t timestamp_from_uptime(int64_t uptime_ms)
+{
+    struct clock_model m;
+
+    seqlock_read(&model_lock, &m, &model, sizeof(m));
+    if (!m.synced) {
+        return uptime_ms;
+    }
+
+    int64_t since = uptime_ms - m.ref_uptime_ms;
+
+    return uptime_ms + m.offset_ms + (since * m.drift_ppb) / 1000000000LL;
+}
+
+int64_t timestamp_resolve(int64_t ts_ms)
+{
+    return timestamp_is_utc(ts_ms) ? ts_ms : timestamp_from_uptime(ts_ms);
+}
+
+bool timestamp_is_utc(int64_t ts_ms)
+{
+    return ts_ms >= TIMESYNC_UTC_MIN_MS;
+}
+
+int64_t timestamp_now(void)
+{
+    return timestamp_from_uptime(k_uptime_get());
+}
+
+bool timesync_is_synced(void)
+{
+    struct clock_model m;
+
+    seqlock_read(&model_lock, &m, &model, sizeof(m));
+    return m.synced;
+}
+
+// One SNTP exchange, returns the measured utc - uptime offset
+static int measure_offset(int64_t *offset_ms, int64_t *at_uptime_ms)
+{
+    struct sntp_time ts;
+    int64_t sent = k_uptime_get();
+    int ret;
+
+    ret = sntp_simple(SNTP_SERVER, SNTP_TIMEOUT_MS, &ts);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // Assume a symmetric path, the server time belongs to the midpoint
+    int64_t received = k_uptime_get();
+    int64_t mid = sent + (received - sent) / 2;
+    int64_t utc_ms = (int64_t)ts.seconds * 1000 +
+                     (((uint64_t)ts.fraction * 1000) >> 32);
+
+    *offset_ms = utc_ms - mid;
+    *at_uptime_ms = mid;
+
+    LOG_DBG("SNTP offset %lld ms, rtt %lld ms",
+            (long long)*offset_ms, (long long)(received - sent));
+    return 0;
+}
+
+static void update_model(int64_t offset_ms, int64_t at_uptime_ms)
+{
+    struct clock_model m = model;
+
+    if (m.synced) {
+        // Drift = how far the offset moved over the time since the last sync
+        int64_t span = at_uptime_ms - m.ref_uptime_ms;
+        int64_t moved = offset_ms - m.offset_ms;
+
+        if (span > 0) {
+            int64_t ppb = (moved * 1000000000LL) / span;
+
+            if (ppb > -TIMESYNC_MAX_DRIFT_PPB && ppb < TIMESYNC_MAX_DRIFT_PPB) {
+                // Smooth to ride out network jitter on single exchanges
+                m.drift_ppb = (int32_t)((m.drift_ppb + ppb) / 2);
+            } else {
+                LOG_WRN("Ignoring drift estimate of %lld ppb", (long long)ppb);
+            }
+        }
+    }
+
+    m.offset_ms = offset_ms;
+    m.ref_uptime_ms = at_uptime_ms;
+    m.synced = true;
+
+    seqlock_write(&model_lock, &model, &m, sizeof(model));
+}
+
+// Time sync thread start function
+static void timesync_thread_start(void *arg_1, void *arg_2, void *arg_3)
+{
+    int64_t offset_ms, at_uptime_ms;
+
+    while (1) {
+        if (measure_offset(&offset_ms, &at_uptime_ms) == 0) {
+            update_model(offset_ms, at_uptime_ms);
+            LOG_INF("Clock synced, drift %d ppb", model.drift_ppb);
+            k_msleep(TIMESYNC_PERIOD_MS);
+        } else {
+            LOG_WRN("SNTP sync failed, retrying");
+            k_msleep(TIMESYNC_RETRY_MS);
+        }
+    }
+}
+
+int timesync_start(void)
+{
+    k_thread_create(&timesync_thread,
+                    timesync_stack,
+                    K_THREAD_STACK_SIZEOF(timesync_stack),
+                    timesync_thread_start,
+                    NULL, NULL, NULL,
+                    TIMESYNC_THREAD_PRIORITY,
+                    0,
+                    K_NO_WAIT);
+    k_thread_name_set(&timesync_thread, "timesync");
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* SNTP backed wall clock
+ Samples keep their k_uptime_get() timestamp, which never jumps or wraps,
+ and are converted to UTC when they are encoded. A sample taken before the
+ first sync is still converted correctly once the clock is synced, so
+ batched and delayed delivery lose nothing.*/
+
+// Start the periodic SNTP sync thread (network must be up)
+int timesync_start(void);
+
+// True once at least one SNTP exchange succeeded
+bool timesync_is_synced(void);
+
+// Convert a k_uptime_get() value to UTC milliseconds since the Unix epoch.
+// Before the first sync the uptime is returned unchanged.
+int64_t timestamp_from_uptime(int64_t uptime_ms);
+
+// Convert a timestamp taken from timestamp_from_uptime() before the first
+// sync, which is still an uptime value, to UTC once synced. Only valid
+// within the same boot.
+int64_t timestamp_resolve(int64_t ts_ms);
+
+// True if ts_ms is UTC, false if it is still an uptime value
+bool timestamp_is_utc(int64_t ts_ms);
+
+// Current UTC time in milliseconds (uptime before the first sync)
+int64_t timestamp_now(void);
+
+#endif // TIMESYNC_H